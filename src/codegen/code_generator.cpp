@@ -6,11 +6,14 @@
 
 namespace compiler {
 
-    void CodeGenerator::generate(const std::vector<ir::ir_instruction>& ir_instructions) {
-        for (auto& instruction : ir_instructions) {
-            std::visit([this](auto& inst) {
-                this->assemble(inst);
-            }, instruction);
+    void CodeGenerator::generate(const ir::ir_program& program) {
+        for (const auto& function : program.functions) {
+            for (const auto& node : function.graph.nodes) {
+                for (const auto& instruction : node.instructions) {
+                    assemble(instruction);
+                }
+            }
+            label_base += static_cast<std::uint32_t>(function.label_count());
         }
 
         std::println();
@@ -25,36 +28,73 @@ namespace compiler {
 
     x86::Operand CodeGenerator::convert_value(const ir::ir_value& value) {
         if (value.is_constant())
-            return x86::Imm{value.get<int>()};
-
-        const auto& var_name = value.get<std::string>();
-        //TODO temp fix
-        if (var_name.starts_with("t")) {
-            return x86::PseudoRegister(var_name);
-        } else {
-            return x86::Mem(get_temp_location(var_name));
-        }
+            return x86::Imm{value.get_constant()};
+
+        if (value.is_temporary())
+            return x86::PseudoRegister("t" + std::to_string(value.get_index()));
 
+        return x86::Mem(get_variable_location(value.get_index()));
     }
 
-    int CodeGenerator::get_temp_location(const std::string& name) {
-        const auto it = temp_var_locations.find(name);
+    int CodeGenerator::get_variable_location(const std::uint32_t index) {
+        if (index >= variable_locations.size())
+            variable_locations.resize(index + 1, 0);
+
+        //offsets are always negative, 0 means not assigned yet
+        if (variable_locations[index] != 0)
+            return variable_locations[index];
 
-        if (it != temp_var_locations.end()) {
-            return it->second;
-        }
         const int offset = current_stack_offset;
-        temp_var_locations[name] = offset;
+        variable_locations[index] = offset;
         current_stack_offset -= 4;
         return offset;
     }
 
-    void CodeGenerator::assemble(const ir::ir_binary& binary) {
-        auto result = convert_value(binary.result);
-        auto left = convert_value(binary.left);
-        auto right = convert_value(binary.right);
+    x86::Label CodeGenerator::convert_label(const std::uint32_t label) const {
+        return x86::Label{label_base + label};
+    }
+
+    void CodeGenerator::assemble(const ir::ir_instruction& instruction) {
+        switch (instruction.opcode) {
+            using enum ir::ir_opcode;
+        case Return:
+            assemble_return(instruction);
+            break;
+        case Binary:
+            assemble_binary(instruction);
+            break;
+        case Unary:
+            assemble_unary(instruction);
+            break;
+        case Copy:
+            assemble_copy(instruction);
+            break;
+        case Label:
+            assemble_label(instruction);
+            break;
+        case Jump:
+            assemble_jump(instruction);
+            break;
+        case JumpIfZero:
+            assemble_jump_if_zero(instruction);
+            break;
+        case JumpIfNotZero:
+            assemble_jump_if_not_zero(instruction);
+            break;
+        case Call:
+            assemble_call(instruction);
+            break;
+        case Phi:
+            throw std::runtime_error("Phi reached codegen, the function is still in SSA form");
+        }
+    }
+
+    void CodeGenerator::assemble_binary(const ir::ir_instruction& binary) {
+        auto result = convert_value(binary.result());
+        auto left = convert_value(binary.left());
+        auto right = convert_value(binary.right());
 
-        switch (binary.op) {
+        switch (binary.op()) {
             using enum token_type;
         case Plus:
             add_instruction(x86::mov{left, result});
@@ -68,6 +108,14 @@ namespace compiler {
             add_instruction(x86::mov{left, result});
             add_instruction(x86::imul{right, result});
             break;
+        case LessLess:
+            add_instruction(x86::mov{left, result});
+            add_instruction(x86::sal{right, result});
+            break;
+        case GreaterGreater:
+            add_instruction(x86::mov{left, result});
+            add_instruction(x86::sar{right, result});
+            break;
         case Slash:
             add_instruction(x86::mov{left, x86::registers::RAX});
             add_instruction(x86::cdq{});
@@ -108,21 +156,21 @@ namespace compiler {
         }
     }
 
-    void CodeGenerator::assemble(const ir::ir_return& ret) {
-        const auto source = convert_value(ret.value);
+    void CodeGenerator::assemble_return(const ir::ir_instruction& ret) {
+        const auto source = convert_value(ret.left());
         add_instruction(x86::mov{source, x86::registers::RAX});
         add_instruction(x86::ret{});
     }
 
-    void CodeGenerator::assemble(const ir::ir_unary& unary) {
-        const auto value = convert_value(unary.value);
-        const auto result = convert_value(unary.result);
+    void CodeGenerator::assemble_unary(const ir::ir_instruction& unary) {
+        const auto value = convert_value(unary.left());
+        const auto result = convert_value(unary.result());
 
-        if (unary.value != unary.result) {
+        if (unary.left() != unary.result()) {
             add_instruction(x86::mov{value, result});
         }
 
-        switch (unary.op) {
+        switch (unary.op()) {
             using enum token_type;
         case Tilde:
             add_instruction(x86::not_{result});
@@ -140,38 +188,38 @@ namespace compiler {
         }
     }
 
-    void CodeGenerator::assemble(const ir::ir_copy& copy) {
-        const auto destination = convert_value(copy.destination);
-        const auto source = convert_value(copy.source);
+    void CodeGenerator::assemble_copy(const ir::ir_instruction& copy) {
+        const auto destination = convert_value(copy.result());
+        const auto source = convert_value(copy.source());
         add_instruction(x86::mov{source, destination});
     }
 
-    void CodeGenerator::assemble(const ir::ir_label& label) {
+    void CodeGenerator::assemble_label(const ir::ir_instruction& label) {
         //TODO scuffed?
-        add_instruction(x86::label{x86::Label{label.name}});
+        add_instruction(x86::label{convert_label(label.label())});
     }
 
-    void CodeGenerator::assemble(const ir::ir_jump& jump) {
-        add_instruction(x86::jmp{x86::Label{jump.label.name}});
+    void CodeGenerator::assemble_jump(const ir::ir_instruction& jump) {
+        add_instruction(x86::jmp{convert_label(jump.label())});
     }
 
-    void CodeGenerator::assemble(const ir::ir_jump_if_zero& jump) {
-        const auto condition = convert_value(jump.condition);
+    void CodeGenerator::assemble_jump_if_zero(const ir::ir_instruction& jump) {
+        const auto condition = convert_value(jump.left());
 
         add_instruction(x86::mov{condition, x86::registers::RAX});
         add_instruction(x86::cmp{x86::Imm{0}, x86::registers::RAX});
-        add_instruction(x86::jmp_cc{x86::CC::Equal, x86::Label{jump.label.name}});
+        add_instruction(x86::jmp_cc{x86::CC::Equal, convert_label(jump.label())});
     }
 
-    void CodeGenerator::assemble(const ir::ir_jump_if_not_zero& jump) {
-        const auto condition = convert_value(jump.condition);
+    void CodeGenerator::assemble_jump_if_not_zero(const ir::ir_instruction& jump) {
+        const auto condition = convert_value(jump.left());
 
         add_instruction(x86::mov{condition, x86::registers::RAX});
         add_instruction(x86::cmp{x86::Imm{0}, x86::registers::RAX});
-        add_instruction(x86::jmp_cc{x86::CC::NotEqual, x86::Label{jump.label.name}});
+        add_instruction(x86::jmp_cc{x86::CC::NotEqual, convert_label(jump.label())});
     }
 
-    void CodeGenerator::assemble(const ir::ir_call& call) {
+    void CodeGenerator::assemble_call(const ir::ir_instruction& call) {
         throw std::runtime_error("eror");
     }
 
@@ -2,16 +2,19 @@
 #include <vector>
 #include "x86_instructions.hpp"
 #include "ir/ir.h"
+#include "ir/ir_function.h"
 
 namespace compiler {
     class CodeGenerator {
     private:
         std::vector<x86::instruction> instructions;
-        std::unordered_map<std::string, int> temp_var_locations;
+        std::vector<int> variable_locations;
         int current_stack_offset = -4;
+        //labels are numbered per function, offset them so they stay unique in the output
+        std::uint32_t label_base = 0;
 
     public:
-        void generate(const std::vector<ir::ir_instruction>& ir_instructions);
+        void generate(const ir::ir_program& program);
 
         void add_instruction(const x86::instruction& instruction) {
             instructions.emplace_back(instruction);
@@ -19,25 +22,29 @@ namespace compiler {
 
         x86::Operand convert_value(const ir::ir_value& value);
 
-        int get_temp_location(const std::string& name);
+        int get_variable_location(std::uint32_t index);
 
-        void assemble(const ir::ir_binary& binary);
+        [[nodiscard]] x86::Label convert_label(std::uint32_t label) const;
 
-        void assemble(const ir::ir_return& ret);
+        void assemble(const ir::ir_instruction& instruction);
 
-        void assemble(const ir::ir_unary& unary);
+        void assemble_binary(const ir::ir_instruction& binary);
 
-        void assemble(const ir::ir_copy& copy);
+        void assemble_return(const ir::ir_instruction& ret);
 
-        void assemble(const ir::ir_label& label);
+        void assemble_unary(const ir::ir_instruction& unary);
 
-        void assemble(const ir::ir_jump& jump);
+        void assemble_copy(const ir::ir_instruction& copy);
 
-        void assemble(const ir::ir_jump_if_zero& jump);
+        void assemble_label(const ir::ir_instruction& label);
 
-        void assemble(const ir::ir_jump_if_not_zero& jump);
+        void assemble_jump(const ir::ir_instruction& jump);
 
-        void assemble(const ir::ir_call& call);
+        void assemble_jump_if_zero(const ir::ir_instruction& jump);
+
+        void assemble_jump_if_not_zero(const ir::ir_instruction& jump);
+
+        void assemble_call(const ir::ir_instruction& call);
 
     };
 }
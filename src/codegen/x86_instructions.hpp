@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <format>
 #include <string>
 #include <utility>
@@ -61,17 +62,17 @@ namespace compiler::x86 {
     };
 
     struct Label {
-        std::string name;
+        std::uint32_t id;
 
-        explicit Label(std::string name)
-            : name(std::move(name)) {}
+        explicit Label(const std::uint32_t id)
+            : id(id) {}
 
         [[nodiscard]] std::string to_str() const {
-            return name;
+            return std::format(".L{}", id);
         }
 
         friend bool operator==(const Label& lhs, const Label& rhs) {
-            return lhs.name == rhs.name;
+            return lhs.id == rhs.id;
         }
 
     };
@@ -242,6 +243,25 @@ namespace compiler::x86 {
         }
     };
 
+    //arithmetic shifts, the count is an immediate
+    struct sal {
+        Operand count;
+        Operand destination;
+
+        [[nodiscard]] std::string emit() const {
+            return std::format("sal {}, {}", operand_to_str(count), operand_to_str(destination));
+        }
+    };
+
+    struct sar {
+        Operand count;
+        Operand destination;
+
+        [[nodiscard]] std::string emit() const {
+            return std::format("sar {}, {}", operand_to_str(count), operand_to_str(destination));
+        }
+    };
+
     struct cdq {
         [[nodiscard]] static std::string emit() {
             return std::format("cdq");
@@ -316,5 +336,5 @@ namespace compiler::x86 {
         }
     };
 
-    using instruction = std::variant<mov, ret, neg, not_, add, sub, imul, cdq, idiv, cmp, label, jmp, jmp_cc, set_cc, push, pop>;
+    using instruction = std::variant<mov, ret, neg, not_, add, sub, imul, sal, sar, cdq, idiv, cmp, label, jmp, jmp_cc, set_cc, push, pop>;
 }
@@ -10,9 +10,10 @@ namespace compiler {
 
         auto ir = ir_generator.generate(ast);
 
-        const auto optimized_ir = optimizer.optimize(ir);
+        optimizer.optimize(ir);
+
         std::println("optimized: ");
-        std::println("{}", ir::printer::ir_printer::to_string(optimized_ir));
-        // code_generator.generate(optimized_ir);
+        std::println("{}", ir::printer::ir_printer{ir}.to_string(ir.functions));
+        // code_generator.generate(ir);
     }
 }
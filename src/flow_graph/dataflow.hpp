@@ -0,0 +1,132 @@
+#pragma once
+#include <vector>
+#include "flow_graph/flow_graph.hpp"
+#include "flow_graph/worklist.hpp"
+#include "util/bit_vector.h"
+
+namespace compiler {
+    enum class DataflowDirection {
+        Forward,
+        Backward,
+    };
+
+    enum class DataflowMeet {
+        Union,
+        Intersection,
+    };
+
+    //Iterative gen/kill solver over a FlowGraph. Only block level sets are stored, passes that need the state at a
+    //single instruction replay their own transfer from in (forward) or out (backward) while they walk the block
+    template <InstructionType T>
+    class Dataflow {
+    public:
+        using GraphType = FlowGraph<T>;
+        using NodeType = Node<T>;
+
+        Dataflow(const DataflowDirection direction, const DataflowMeet meet)
+            : direction(direction),
+              meet(meet) {}
+
+        //local_sets(node, gen, kill) summarizes one block, boundary is the value flowing out of ENTRY or into EXIT
+        template <typename LocalSets>
+        void solve(const GraphType& graph, const std::size_t universe, const util::bit_vector& boundary, LocalSets&& local_sets) {
+            const auto slots = static_cast<std::size_t>(graph.max_node_id()) + 2;
+            const util::bit_vector top(universe, meet == DataflowMeet::Intersection);
+
+            gen.assign(slots, util::bit_vector(universe));
+            kill.assign(slots, util::bit_vector(universe));
+            in.assign(slots, top);
+            out.assign(slots, top);
+
+            for (const auto& node : graph.nodes) {
+                if (node.id == ENTRY || node.id == EXIT || node.removed)
+                    continue;
+
+                local_sets(node, gen[slot(node.id)], kill[slot(node.id)]);
+            }
+
+            const bool backward = direction == DataflowDirection::Backward;
+            if (backward)
+                in[slot(EXIT)] = out[slot(EXIT)] = boundary;
+            else
+                in[slot(ENTRY)] = out[slot(ENTRY)] = boundary;
+
+            Worklist worklist(worklist_order(graph, backward), graph.max_node_id());
+            worklist.push_all();
+
+            while (!worklist.empty()) {
+                const auto& node = graph.get_node_from_id(worklist.pop());
+                if (node.id == ENTRY || node.id == EXIT)
+                    continue;
+
+                const auto index = slot(node.id);
+                if (backward) {
+                    if (update(node.id, out[index], in[index], combine(node.successors, in, top))) {
+                        for (const auto predecessor : node.predecessors)
+                            worklist.push(predecessor);
+                    }
+                } else if (update(node.id, in[index], out[index], combine(node.predecessors, out, top))) {
+                    for (const auto successor : node.successors)
+                        worklist.push(successor);
+                }
+            }
+
+            if (backward)
+                in[slot(ENTRY)] = out[slot(ENTRY)] = combine(graph.get_node_from_id(ENTRY).successors, in, top);
+            else
+                in[slot(EXIT)] = out[slot(EXIT)] = combine(graph.get_node_from_id(EXIT).predecessors, out, top);
+        }
+
+        [[nodiscard]] const util::bit_vector& in_of(const int node_id) const {
+            return in.at(slot(node_id));
+        }
+
+        [[nodiscard]] const util::bit_vector& out_of(const int node_id) const {
+            return out.at(slot(node_id));
+        }
+
+    private:
+        DataflowDirection direction;
+        DataflowMeet meet;
+        //indexed by node id + 1, like the graph positions
+        std::vector<util::bit_vector> gen;
+        std::vector<util::bit_vector> kill;
+        std::vector<util::bit_vector> in;
+        std::vector<util::bit_vector> out;
+
+        static std::size_t slot(const int node_id) {
+            return static_cast<std::size_t>(node_id + 1);
+        }
+
+        //meet over the given neighbours, a block without any gets top
+        template <typename Neighbours>
+        util::bit_vector combine(const Neighbours& neighbours, const std::vector<util::bit_vector>& sets, const util::bit_vector& top) const {
+            if (neighbours.empty())
+                return top;
+
+            auto result = sets[slot(neighbours.front())];
+            for (const auto neighbour : neighbours) {
+                if (meet == DataflowMeet::Union)
+                    result |= sets[slot(neighbour)];
+                else
+                    result &= sets[slot(neighbour)];
+            }
+            return result;
+        }
+
+        bool update(const int node_id, util::bit_vector& source, util::bit_vector& target, util::bit_vector incoming) {
+            const auto index = slot(node_id);
+            source = std::move(incoming);
+
+            auto result = source;
+            result.subtract(kill[index]);
+            result |= gen[index];
+
+            if (result == target)
+                return false;
+
+            target = std::move(result);
+            return true;
+        }
+    };
+}
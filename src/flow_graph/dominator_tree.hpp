@@ -0,0 +1,174 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "util/small_vector.h"
+
+namespace compiler {
+    //Dominator tree built with the Cooper-Harvey-Kennedy iterative algorithm, plus dominance frontiers.
+    //Works on node ids and is direction agnostic: build it over predecessors from ENTRY for dominators,
+    //or over successors from EXIT for post-dominators
+    class DominatorTree {
+    public:
+        static constexpr int NONE = -2;
+
+        //order is the reverse postorder from the root, preds(id) gives the incoming neighbours in the same direction
+        template <typename Predecessors>
+        void build(const std::vector<int>& order, const int max_node_id, Predecessors&& preds) {
+            const auto slots = static_cast<std::size_t>(max_node_id) + 2;
+            root = order.front();
+            idoms.assign(slots, NONE);
+            numbers.assign(slots, NONE);
+            tree_children.assign(slots, {});
+            frontiers.assign(slots, {});
+
+            for (std::size_t i = 0; i < order.size(); ++i)
+                numbers[slot(order[i])] = static_cast<int>(i);
+
+            idoms[slot(root)] = root;
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                for (std::size_t i = 1; i < order.size(); ++i) {
+                    const int node = order[i];
+                    int new_idom = NONE;
+
+                    for (const int pred : preds(node)) {
+                        if (idoms[slot(pred)] == NONE)
+                            continue;
+
+                        new_idom = new_idom == NONE ? pred : intersect(pred, new_idom);
+                    }
+
+                    if (idoms[slot(node)] != new_idom) {
+                        idoms[slot(node)] = new_idom;
+                        changed = true;
+                    }
+                }
+            }
+
+            for (std::size_t i = 1; i < order.size(); ++i)
+                tree_children[slot(idoms[slot(order[i])])].push_back(order[i]);
+
+            number_tree();
+            build_frontiers(order, preds);
+        }
+
+        [[nodiscard]] int get_root() const {
+            return root;
+        }
+
+        //false for nodes the root cannot reach, they have no dominator information
+        [[nodiscard]] bool contains(const int node_id) const {
+            return slot(node_id) < idoms.size() && idoms[slot(node_id)] != NONE;
+        }
+
+        //immediate dominator, the root is its own
+        [[nodiscard]] int idom(const int node_id) const {
+            return idoms[slot(node_id)];
+        }
+
+        //O(1) with the preorder interval of the tree
+        [[nodiscard]] bool dominates(const int dominator, const int node_id) const {
+            if (!contains(dominator) || !contains(node_id))
+                return false;
+
+            return preorder[slot(dominator)] <= preorder[slot(node_id)] && preorder[slot(node_id)] <= last_descendant[slot(dominator)];
+        }
+
+        [[nodiscard]] bool strictly_dominates(const int dominator, const int node_id) const {
+            return dominator != node_id && dominates(dominator, node_id);
+        }
+
+        [[nodiscard]] const std::vector<int>& children(const int node_id) const {
+            return tree_children[slot(node_id)];
+        }
+
+        [[nodiscard]] const util::small_vector<int, 2>& frontier(const int node_id) const {
+            return frontiers[slot(node_id)];
+        }
+
+        //nodes in tree preorder, a dominator always comes before the nodes it dominates
+        [[nodiscard]] const std::vector<int>& preorder_nodes() const {
+            return tree_preorder;
+        }
+
+    private:
+        int root = NONE;
+        //all indexed by node id + 1
+        std::vector<int> idoms;
+        //position in the build order, used by intersect
+        std::vector<int> numbers;
+        std::vector<std::vector<int> > tree_children;
+        std::vector<util::small_vector<int, 2> > frontiers;
+        std::vector<int> preorder;
+        std::vector<int> last_descendant;
+        std::vector<int> tree_preorder;
+
+        static std::size_t slot(const int node_id) {
+            return static_cast<std::size_t>(node_id + 1);
+        }
+
+        int intersect(int left, int right) const {
+            while (left != right) {
+                while (numbers[slot(left)] > numbers[slot(right)])
+                    left = idoms[slot(left)];
+                while (numbers[slot(right)] > numbers[slot(left)])
+                    right = idoms[slot(right)];
+            }
+            return left;
+        }
+
+        void number_tree() {
+            preorder.assign(idoms.size(), NONE);
+            last_descendant.assign(idoms.size(), NONE);
+            tree_preorder.clear();
+
+            std::vector<std::pair<int, std::size_t> > stack;
+            stack.emplace_back(root, 0);
+            preorder[slot(root)] = 0;
+            tree_preorder.push_back(root);
+
+            while (!stack.empty()) {
+                auto& [node, next] = stack.back();
+                const auto& node_children = tree_children[slot(node)];
+
+                if (next < node_children.size()) {
+                    const int child = node_children[next++];
+                    preorder[slot(child)] = static_cast<int>(tree_preorder.size());
+                    tree_preorder.push_back(child);
+                    stack.emplace_back(child, 0);
+                    continue;
+                }
+
+                last_descendant[slot(node)] = static_cast<int>(tree_preorder.size()) - 1;
+                stack.pop_back();
+            }
+        }
+
+        template <typename Predecessors>
+        void build_frontiers(const std::vector<int>& order, Predecessors& preds) {
+            for (const int node : order) {
+                std::size_t incoming = 0;
+                for (const int pred : preds(node)) {
+                    if (contains(pred))
+                        ++incoming;
+                }
+
+                if (incoming < 2)
+                    continue;
+
+                for (const int pred : preds(node)) {
+                    if (!contains(pred))
+                        continue;
+
+                    for (int runner = pred; runner != idom(node); runner = idom(runner)) {
+                        auto& runner_frontier = frontiers[slot(runner)];
+                        if (runner_frontier.empty() || runner_frontier.back() != node)
+                            runner_frontier.push_back(node);
+                    }
+                }
+            }
+        }
+    };
+}
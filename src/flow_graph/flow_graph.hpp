@@ -1,15 +1,19 @@
 #pragma once
+#include <algorithm>
 #include <concepts>
+#include <cstdint>
+#include <format>
+#include <iterator>
+#include <stdexcept>
 #include <vector>
 #include "codegen/x86_instructions.hpp"
+#include "flow_graph/dominator_tree.hpp"
+#include "flow_graph/loop_info.hpp"
+#include "flow_graph/node_type.hpp"
 #include "ir/ir.h"
+#include "util/small_vector.h"
 
 namespace compiler {
-    enum node_type {
-        EXIT = -1,
-        ENTRY = 0,
-    };
-
     template <typename T>
     concept InstructionType = std::same_as<T, ir::ir_instruction> || std::same_as<T, x86::instruction>;
 
@@ -17,15 +21,18 @@ namespace compiler {
     struct Node {
         int id;
         std::vector<T> instructions;
-        std::vector<int> predecessors;
-        std::vector<int> successors;
+        //a block has at most two successors, most have one or two predecessors
+        util::small_vector<int, 4> predecessors;
+        util::small_vector<int, 2> successors;
+        //removed nodes stay in place as tombstones so ids and positions stay valid
+        bool removed = false;
 
         explicit Node(const int id)
             : id(id) {}
 
-        Node(const int id, const std::vector<T>& instructions)
+        Node(const int id, std::vector<T> instructions)
             : id(id),
-              instructions(instructions) {}
+              instructions(std::move(instructions)) {}
 
         friend bool operator==(const Node& lhs, const Node& rhs) {
             return lhs.id == rhs.id;
@@ -59,50 +66,41 @@ namespace compiler {
         using Instr = ir::ir_instruction;
 
         static bool is_label(const Instr& instruction) {
-            return std::holds_alternative<ir::ir_label>(instruction);
+            return instruction.opcode == ir::ir_opcode::Label;
         }
 
-        static std::string label_name(const Instr& instruction) {
-            if (const auto label = std::get_if<ir::ir_label>(&instruction)) {
-                return label->name;
-            }
+        static std::uint32_t label_name(const Instr& instruction) {
+            if (is_label(instruction))
+                return instruction.label();
+
             throw std::runtime_error("Instruction is not label");
         }
 
         static bool is_conditional_jump(const Instr& instruction) {
-            return std::holds_alternative<ir::ir_jump_if_zero>(instruction)
-                   || std::holds_alternative<ir::ir_jump_if_not_zero>(instruction);
+            return instruction.is_conditional_jump();
         }
 
         static bool is_unconditional_jump(const Instr& instruction) {
-            return std::holds_alternative<ir::ir_jump>(instruction);
+            return instruction.opcode == ir::ir_opcode::Jump;
         }
 
-        static std::string jump_label(const Instr& instruction) {
-            if (std::holds_alternative<ir::ir_jump>(instruction))
-                return std::get<ir::ir_jump>(instruction).label.name;
-
-            if (std::holds_alternative<ir::ir_jump_if_zero>(instruction))
-                return std::get<ir::ir_jump_if_zero>(instruction).label.name;
-
-            if (std::holds_alternative<ir::ir_jump_if_not_zero>(instruction))
-                return std::get<ir::ir_jump_if_not_zero>(instruction).label.name;
+        static std::uint32_t jump_label(const Instr& instruction) {
+            if (instruction.is_jump())
+                return instruction.label();
 
             throw std::runtime_error("Instruction is not jump");
         }
 
         static bool is_block_starter(const Instr& instruction) {
-            return std::holds_alternative<ir::ir_jump>(instruction)
-                   || std::holds_alternative<ir::ir_jump_if_zero>(instruction)
-                   || std::holds_alternative<ir::ir_return>(instruction);
+            return is_label(instruction);
         }
 
         static bool is_block_terminator(const Instr& instruction) {
-            return is_label(instruction);
+            return instruction.is_jump() || instruction.opcode == ir::ir_opcode::Return;
         }
 
         static bool is_ret(const Instr& instruction) {
-            return std::holds_alternative<ir::ir_return>(instruction);
+            return instruction.opcode == ir::ir_opcode::Return;
         }
 
     };
@@ -123,31 +121,31 @@ namespace compiler {
             return std::holds_alternative<x86::jmp>(instruction);
         }
 
-        static std::string jump_label(const Instr& instruction) {
+        static std::uint32_t jump_label(const Instr& instruction) {
             if (const auto jmp = std::get_if<x86::jmp>(&instruction))
-                return jmp->target.name;
+                return jmp->target.id;
 
             if (const auto jmp_cc = std::get_if<x86::jmp_cc>(&instruction))
-                return jmp_cc->target.name;
+                return jmp_cc->target.id;
 
             throw std::runtime_error("Instruction is not jump");
         }
 
-        static std::string label_name(const Instr& instruction) {
+        static std::uint32_t label_name(const Instr& instruction) {
             if (const auto label = std::get_if<x86::label>(&instruction)) {
-                return label->name.name;
+                return label->name.id;
             }
             throw std::runtime_error("Instruction is not label");
         }
 
         static bool is_block_starter(const Instr& instruction) {
-            return std::holds_alternative<x86::jmp>(instruction)
-                   || std::holds_alternative<x86::jmp_cc>(instruction)
-                   || std::holds_alternative<x86::ret>(instruction);
+            return is_label(instruction);
         }
 
         static bool is_block_terminator(const Instr& instruction) {
-            return is_label(instruction);
+            return std::holds_alternative<x86::jmp>(instruction)
+                   || std::holds_alternative<x86::jmp_cc>(instruction)
+                   || std::holds_alternative<x86::ret>(instruction);
         }
 
         static bool is_ret(const Instr& instruction) {
@@ -159,63 +157,203 @@ namespace compiler {
     class FlowGraph {
     public:
         using NodeType = Node<T>;
+        //nodes in layout order, ENTRY first and EXIT last
         std::vector<NodeType> nodes;
 
-        void generate_flowgraph(const std::vector<T>& instructions) {
-            auto basic_blocks = partition_to_bb(instructions);
+        void generate_flowgraph(std::vector<T> instructions) {
+            generate_flowgraph(partition_to_bb(std::move(instructions)));
+        }
+
+        //Builds the graph from blocks that are already split at labels and jumps, used by the IR generator.
+        //Blocks are moved into the nodes, pass them with std::move to avoid copying every instruction
+        void generate_flowgraph(std::vector<std::vector<T> > basic_blocks) {
             nodes.clear();
+            nodes.reserve(basic_blocks.size() + 2);
+            id_counter = 0;
 
             nodes.emplace_back(ENTRY);
 
             for (auto& bb : basic_blocks)
-                nodes.emplace_back(++id_counter, bb);
+                nodes.emplace_back(++id_counter, std::move(bb));
 
             nodes.emplace_back(EXIT);
+            build_position_index();
             build_label_cache();
             add_all_edges();
+            invalidate_analyses();
         }
 
-        [[nodiscard]] NodeType& get_node_from_id(int node_id) {
-            for (auto& node : nodes) {
-                if (node.id == node_id)
-                    return node;
+        [[nodiscard]] bool contains_node(const int node_id) const {
+            const auto slot = static_cast<std::size_t>(node_id + 1);
+            return slot < positions.size() && positions[slot] != INVALID;
+        }
+
+        [[nodiscard]] NodeType& get_node_from_id(const int node_id) {
+            return nodes[position_of(node_id)];
+        }
+
+        [[nodiscard]] const NodeType& get_node_from_id(const int node_id) const {
+            return nodes[position_of(node_id)];
+        }
+
+        //position of the node in layout order
+        [[nodiscard]] std::size_t position_of(const int node_id) const {
+            if (!contains_node(node_id))
+                throw std::runtime_error("Node not found with id: " + std::to_string(node_id));
+
+            return static_cast<std::size_t>(positions[node_id + 1]);
+        }
+
+        //closest block before it in layout order that is not removed, the one that can fall through into it
+        [[nodiscard]] int layout_predecessor(const int node_id) const {
+            auto position = position_of(node_id);
+            while (position > 0) {
+                --position;
+                if (!nodes[position].removed)
+                    return nodes[position].id;
             }
-            throw std::runtime_error("Node not found with id: " + std::to_string(node_id));
+            return INVALID;
+        }
+
+        //ids are dense, usable to size per node side tables
+        [[nodiscard]] int max_node_id() const {
+            return id_counter;
         }
 
+        void add_edge(const int start_id, const int end_id) {
+            get_node_from_id(start_id).successors.push_back(end_id);
+            get_node_from_id(end_id).predecessors.push_back(start_id);
+            invalidate_analyses();
+        }
+
+        void remove_edge(const int start_id, const int end_id) {
+            util::erase(get_node_from_id(start_id).successors, end_id);
+            util::erase(get_node_from_id(end_id).predecessors, start_id);
+            invalidate_analyses();
+        }
+
+        //detaches the node from all of its neighbours
         void remove_edge(const NodeType& node) {
-            for (const auto successor : node.successors) {
-                auto n = get_node_from_id(successor);
-                std::erase(n.predecessors, node.id);
-            }
+            for (const auto successor : node.successors)
+                util::erase(get_node_from_id(successor).predecessors, node.id);
 
-            for (const auto predecessor : node.predecessors) {
-                auto n = get_node_from_id(predecessor);
-                std::erase(n.successors, node.id);
-            }
+            for (const auto predecessor : node.predecessors)
+                util::erase(get_node_from_id(predecessor).successors, node.id);
+
+            invalidate_analyses();
         }
 
-        void add_node(const NodeType& node) {
-            nodes.emplace_back(node);
+        //Inserts a new node before before_id in layout order and returns its id. Edges are left to the caller.
+        //Shifts the positions after it, so it is O(n), passes should batch structural changes
+        int add_node(std::vector<T> instructions, const int before_id = EXIT) {
+            const auto position = position_of(before_id);
+            const int id = ++id_counter;
+
+            nodes.emplace(nodes.begin() + static_cast<std::ptrdiff_t>(position), id, std::move(instructions));
+            build_position_index();
+            cache_label(nodes[position]);
+            invalidate_analyses();
+            return id;
         }
 
         void remove_node(const NodeType& node) {
-            remove_edge(node);
-            std::erase(nodes, node);
+            remove_node(node.id);
         }
 
         void remove_node(const int id) {
-            const auto node = get_node_from_id(id);
-            remove_node(node);
+            auto& node = get_node_from_id(id);
+            remove_edge(node);
+            uncache_label(node);
+            node.successors.clear();
+            node.predecessors.clear();
+            node.instructions.clear();
+            node.removed = true;
+        }
+
+        //Drops tombstones, ids of removed nodes become invalid
+        void compact() {
+            std::erase_if(nodes, [](const NodeType& node) {
+                return node.removed;
+            });
+            build_position_index();
+            invalidate_analyses();
         }
 
+        //Block ids reachable from ENTRY in reverse postorder, the usual visiting order for forward problems
+        [[nodiscard]] const std::vector<int>& reverse_postorder() const {
+            if (!order_valid)
+                compute_order();
+
+            return rpo;
+        }
+
+        //Position of the block in reverse_postorder, INVALID for blocks not reachable from ENTRY
+        [[nodiscard]] int rpo_number(const int node_id) const {
+            if (!order_valid)
+                compute_order();
+
+            return rpo_numbers[node_id + 1];
+        }
+
+        [[nodiscard]] const DominatorTree& dominators() const {
+            if (!dominators_valid) {
+                dominator_tree.build(reverse_postorder(), id_counter, [this](const int id) -> const auto& {
+                    return get_node_from_id(id).predecessors;
+                });
+                dominators_valid = true;
+            }
+            return dominator_tree;
+        }
+
+        //Rooted at EXIT, blocks that never reach EXIT (infinite loops) are not part of it
+        [[nodiscard]] const DominatorTree& post_dominators() const {
+            if (!post_dominators_valid) {
+                std::vector<int> reverse_order;
+                depth_first_postorder(EXIT, true, reverse_order);
+                std::ranges::reverse(reverse_order);
+
+                post_dominator_tree.build(reverse_order, id_counter, [this](const int id) -> const auto& {
+                    return get_node_from_id(id).successors;
+                });
+                post_dominators_valid = true;
+            }
+            return post_dominator_tree;
+        }
+
+        [[nodiscard]] const LoopInfo& loops() const {
+            if (!loops_valid) {
+                loop_info.build(*this);
+                loops_valid = true;
+            }
+            return loop_info;
+        }
+
+        //Cached analyses depend on the edges, anything that edits them without the methods above has to call this
+        void invalidate_analyses() {
+            order_valid = false;
+            dominators_valid = false;
+            post_dominators_valid = false;
+            loops_valid = false;
+        }
+
+        int label_to_block_id(const std::uint32_t label) const {
+            if (label < labels_to_block_id.size() && labels_to_block_id[label] != INVALID) {
+                return labels_to_block_id[label];
+            }
+            throw std::runtime_error(std::format("Label not found: {}", label));
+        }
+
+        //Moves every instruction out of the graph in block order, the nodes are left empty
+        [[nodiscard]] std::vector<T> release_instructions() {
+            std::size_t count = 0;
+            for (const auto& node : nodes)
+                count += node.instructions.size();
 
-        [[nodiscard]] std::vector<T> emit_instructions() const {
             std::vector<T> instructions;
-            for (const auto& node : nodes) {
-                for (const auto& instr : node.instructions) {
-                    instructions.emplace_back(instr);
-                }
+            instructions.reserve(count);
+            for (auto& node : nodes) {
+                std::ranges::move(node.instructions, std::back_inserter(instructions));
+                node.instructions.clear();
             }
             return instructions;
         }
@@ -223,87 +361,143 @@ namespace compiler {
     private:
         using adapter = InstructionAdapter<T>;
         int id_counter = 0;
-        std::unordered_map<std::string, int> labels_to_block_id;
+        //indexed by id + 1 so EXIT gets slot 0, holds the layout position or INVALID
+        std::vector<int> positions;
+        //indexed by label id
+        std::vector<int> labels_to_block_id;
+
+        mutable bool order_valid = false;
+        mutable std::vector<int> rpo;
+        //indexed by id + 1
+        mutable std::vector<int> rpo_numbers;
+
+        mutable bool dominators_valid = false;
+        mutable DominatorTree dominator_tree;
+        mutable bool post_dominators_valid = false;
+        mutable DominatorTree post_dominator_tree;
+        mutable bool loops_valid = false;
+        mutable LoopInfo loop_info;
+
+        void compute_order() const {
+            depth_first_postorder(ENTRY, false, rpo);
+            std::ranges::reverse(rpo);
+
+            rpo_numbers.assign(static_cast<std::size_t>(id_counter) + 2, INVALID);
+            for (std::size_t i = 0; i < rpo.size(); ++i)
+                rpo_numbers[rpo[i] + 1] = static_cast<int>(i);
+
+            order_valid = true;
+        }
 
-        void build_label_cache() {
-            for (const auto& node : nodes) {
-                if (!node.instructions.empty()) {
-                    const auto instruction = node.instructions.front();
-                    if (adapter::is_label(instruction)) {
-                        auto name = adapter::label_name(instruction);
-                        labels_to_block_id[name] = node.id;
+        //iterative dfs, deep CFGs would overflow the stack with recursion. reverse walks the predecessor edges
+        void depth_first_postorder(const int root, const bool reverse, std::vector<int>& postorder) const {
+            postorder.clear();
+
+            std::vector<bool> visited(static_cast<std::size_t>(id_counter) + 2, false);
+            std::vector<std::pair<int, std::size_t> > stack;
+            stack.emplace_back(root, 0);
+            visited[root + 1] = true;
+
+            while (!stack.empty()) {
+                auto& [id, next] = stack.back();
+                const auto& node = get_node_from_id(id);
+                const int* neighbours = reverse ? node.predecessors.data() : node.successors.data();
+                const auto count = reverse ? node.predecessors.size() : node.successors.size();
+
+                if (next < count) {
+                    const int neighbour = neighbours[next++];
+                    if (!visited[neighbour + 1]) {
+                        visited[neighbour + 1] = true;
+                        stack.emplace_back(neighbour, 0);
                     }
+                    continue;
                 }
+
+                postorder.push_back(id);
+                stack.pop_back();
             }
         }
 
-        int label_to_block_id(const std::string& label) {
-            if (labels_to_block_id.contains(label)) {
-                return labels_to_block_id[label];
-            }
-            throw std::runtime_error("Label not found: " + label);
+        void build_position_index() {
+            positions.assign(static_cast<std::size_t>(id_counter) + 2, INVALID);
+            for (std::size_t i = 0; i < nodes.size(); ++i)
+                positions[nodes[i].id + 1] = static_cast<int>(i);
+        }
+
+        void cache_label(const NodeType& node) {
+            if (node.instructions.empty() || !adapter::is_label(node.instructions.front()))
+                return;
+
+            const auto label = adapter::label_name(node.instructions.front());
+            if (label >= labels_to_block_id.size())
+                labels_to_block_id.resize(label + 1, INVALID);
+
+            labels_to_block_id[label] = node.id;
         }
 
-        std::vector<std::vector<T> > partition_to_bb(const std::vector<T>& instructions) {
+        void uncache_label(const NodeType& node) {
+            if (node.instructions.empty() || !adapter::is_label(node.instructions.front()))
+                return;
+
+            const auto label = adapter::label_name(node.instructions.front());
+            if (label < labels_to_block_id.size() && labels_to_block_id[label] == node.id)
+                labels_to_block_id[label] = INVALID;
+        }
+
+        void build_label_cache() {
+            labels_to_block_id.clear();
+            for (const auto& node : nodes)
+                cache_label(node);
+        }
+
+        std::vector<std::vector<T> > partition_to_bb(std::vector<T> instructions) {
             std::vector<std::vector<T> > finished_blocks;
             std::vector<T> current_block;
 
-            for (const auto& instruction : instructions) {
+            for (auto& instruction : instructions) {
                 if (adapter::is_block_starter(instruction)) {
                     if (!current_block.empty())
-                        finished_blocks.emplace_back(current_block);
+                        finished_blocks.emplace_back(std::move(current_block));
 
-                    current_block.clear();
-                    current_block.push_back(instruction);
+                    current_block = {};
+                    current_block.push_back(std::move(instruction));
                     continue;
                 }
 
                 if (adapter::is_block_terminator(instruction)) {
-                    current_block.emplace_back(instruction);
-                    finished_blocks.emplace_back(current_block);
-                    current_block.clear();
+                    current_block.emplace_back(std::move(instruction));
+                    finished_blocks.emplace_back(std::move(current_block));
+                    current_block = {};
                     continue;
                 }
 
-                current_block.emplace_back(instruction);
+                current_block.emplace_back(std::move(instruction));
             }
 
             if (!current_block.empty())
-                finished_blocks.emplace_back(current_block);
+                finished_blocks.emplace_back(std::move(current_block));
 
             return finished_blocks;
         }
 
-        void add_edge(const int start_id, const int end_id) {
-            for (auto& node : nodes) {
-                if (node.id == start_id)
-                    node.successors.push_back(end_id);
-
-                if (node.id == end_id)
-                    node.predecessors.push_back(start_id);
-            }
-        }
-
         void add_all_edges() {
-            if (nodes.size() < 2) {
+            if (nodes.size() <= 2) {
                 add_edge(ENTRY, EXIT);
                 return;
             }
 
-            add_edge(ENTRY, 1);
-            for (const auto& node : nodes) {
-                int next_id;
+            add_edge(ENTRY, nodes[1].id);
+            for (std::size_t i = 1; i + 1 < nodes.size(); ++i) {
+                const auto& node = nodes[i];
+                //the node after the last block is EXIT
+                const int next_id = nodes[i + 1].id;
 
-                if (node.id == ENTRY || node.id == EXIT)
+                if (node.instructions.empty()) {
+                    add_edge(node.id, next_id);
                     continue;
+                }
 
-                //reached the last node
-                if (node.id == id_counter)
-                    next_id = EXIT;
-                else
-                    next_id = node.id + 1;
-
-                auto last_instruction = node.instructions.back();
+                const auto& last_instruction = node.instructions.back();
 
                 if (adapter::is_ret(last_instruction)) {
                     add_edge(node.id, EXIT);
@@ -332,4 +526,3 @@ namespace compiler {
 
     };
 }
-
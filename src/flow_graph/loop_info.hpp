@@ -0,0 +1,164 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "flow_graph/node_type.hpp"
+
+namespace compiler {
+    struct Loop {
+        int header;
+        //header first, then the rest of the body in no particular order
+        std::vector<int> blocks;
+        //sources of the back edges into the header
+        std::vector<int> latches;
+        //edges leaving the loop, as (inside, outside)
+        std::vector<std::pair<int, int> > exits;
+        //only predecessor of the header from outside the loop when its single successor is the header, INVALID otherwise
+        int preheader;
+        //index into LoopInfo::loops, NO_LOOP for outermost loops
+        int parent;
+        int depth;
+    };
+
+    //Natural loops of a FlowGraph, nested into a forest. Loops sharing a header are merged into one.
+    //Outer loops come before the loops nested in them
+    class LoopInfo {
+    public:
+        static constexpr int NO_LOOP = -1;
+
+        template <typename Graph>
+        void build(const Graph& graph) {
+            const auto& dominators = graph.dominators();
+            const auto slots = static_cast<std::size_t>(graph.max_node_id()) + 2;
+
+            all_loops.clear();
+            innermost.assign(slots, NO_LOOP);
+
+            //a back edge goes to a block that dominates its source
+            for (const auto id : graph.reverse_postorder()) {
+                for (const auto predecessor : graph.get_node_from_id(id).predecessors) {
+                    if (!dominators.dominates(id, predecessor))
+                        continue;
+
+                    auto loop = std::ranges::find_if(all_loops, [id](const Loop& existing) {
+                        return existing.header == id;
+                    });
+                    if (loop == all_loops.end()) {
+                        all_loops.push_back({id, {id}, {}, {}, INVALID, NO_LOOP, 1});
+                        loop = all_loops.end() - 1;
+                    }
+                    if (!std::ranges::contains(loop->latches, predecessor))
+                        loop->latches.push_back(predecessor);
+                }
+            }
+
+            std::vector<std::size_t> marks(slots, 0);
+            std::size_t stamp = 0;
+
+            for (auto& loop : all_loops) {
+                //body: everything reaching a latch backwards without going through the header
+                ++stamp;
+                marks[loop.header + 1] = stamp;
+                std::vector<int> worklist;
+                for (const auto latch : loop.latches) {
+                    if (marks[latch + 1] != stamp) {
+                        marks[latch + 1] = stamp;
+                        loop.blocks.push_back(latch);
+                        worklist.push_back(latch);
+                    }
+                }
+
+                while (!worklist.empty()) {
+                    const auto block = worklist.back();
+                    worklist.pop_back();
+
+                    for (const auto predecessor : graph.get_node_from_id(block).predecessors) {
+                        if (marks[predecessor + 1] == stamp || !dominators.contains(predecessor))
+                            continue;
+
+                        marks[predecessor + 1] = stamp;
+                        loop.blocks.push_back(predecessor);
+                        worklist.push_back(predecessor);
+                    }
+                }
+
+                for (const auto block : loop.blocks) {
+                    for (const auto successor : graph.get_node_from_id(block).successors) {
+                        if (marks[successor + 1] != stamp)
+                            loop.exits.emplace_back(block, successor);
+                    }
+                }
+
+                loop.preheader = find_preheader(graph, loop, marks, stamp);
+            }
+
+            std::ranges::stable_sort(all_loops, [](const Loop& left, const Loop& right) {
+                return left.blocks.size() > right.blocks.size();
+            });
+
+            //natural loops are nested or disjoint, so whatever larger loop already claimed the header is the parent
+            for (std::size_t i = 0; i < all_loops.size(); ++i) {
+                auto& loop = all_loops[i];
+                loop.parent = innermost[loop.header + 1];
+                loop.depth = loop.parent == NO_LOOP ? 1 : all_loops[loop.parent].depth + 1;
+
+                for (const auto block : loop.blocks)
+                    innermost[block + 1] = static_cast<int>(i);
+            }
+        }
+
+        [[nodiscard]] const std::vector<Loop>& loops() const {
+            return all_loops;
+        }
+
+        //innermost loop containing the block, NO_LOOP outside of any loop
+        [[nodiscard]] int loop_of(const int block_id) const {
+            return innermost[block_id + 1];
+        }
+
+        //0 outside of any loop
+        [[nodiscard]] int depth(const int block_id) const {
+            const auto loop = loop_of(block_id);
+            return loop == NO_LOOP ? 0 : all_loops[loop].depth;
+        }
+
+        [[nodiscard]] bool contains(const int loop_index, const int block_id) const {
+            for (auto loop = loop_of(block_id); loop != NO_LOOP; loop = all_loops[loop].parent) {
+                if (loop == loop_index)
+                    return true;
+            }
+            return false;
+        }
+
+    private:
+        std::vector<Loop> all_loops;
+        //indexed by block id + 1
+        std::vector<int> innermost;
+
+        template <typename Graph>
+        static int find_preheader(const Graph& graph, const Loop& loop, const std::vector<std::size_t>& marks, const std::size_t stamp) {
+            int candidate = INVALID;
+            for (const auto predecessor : graph.get_node_from_id(loop.header).predecessors) {
+                if (marks[predecessor + 1] == stamp || predecessor == candidate)
+                    continue;
+
+                if (candidate != INVALID)
+                    return INVALID;
+
+                candidate = predecessor;
+            }
+
+            //ENTRY can not hold instructions
+            if (candidate == INVALID || candidate == ENTRY)
+                return INVALID;
+
+            const auto& successors = graph.get_node_from_id(candidate).successors;
+            const bool only_header = std::ranges::all_of(successors, [&loop](const int successor) {
+                return successor == loop.header;
+            });
+
+            return only_header ? candidate : INVALID;
+        }
+    };
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+namespace compiler {
+    enum node_type {
+        INVALID = -2,
+        EXIT = -1,
+        ENTRY = 0,
+    };
+}
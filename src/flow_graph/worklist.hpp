@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include "flow_graph/flow_graph.hpp"
+#include "util/bit_vector.h"
+
+namespace compiler {
+    //Block worklist that always hands out the pending block that comes first in the given order.
+    //Membership is a bitmap over order positions, so push is O(1) and a block is never queued twice.
+    //Blocks pushed behind the cursor wait for the next sweep, so an RPO order converges in a few passes over a loop
+    class Worklist {
+    public:
+        //order holds node ids, ids that are not in it are ignored by push
+        explicit Worklist(std::vector<int> order, const int max_node_id)
+            : order(std::move(order)),
+              positions(static_cast<std::size_t>(max_node_id) + 2, INVALID),
+              pending(this->order.size()) {
+            for (std::size_t i = 0; i < this->order.size(); ++i)
+                positions[this->order[i] + 1] = static_cast<int>(i);
+        }
+
+        void push(const int node_id) {
+            const auto position = positions[node_id + 1];
+            if (position == INVALID || pending.test(position))
+                return;
+
+            pending.set(position);
+            ++size;
+        }
+
+        void push_all() {
+            pending.set_all();
+            size = order.size();
+        }
+
+        [[nodiscard]] bool empty() const {
+            return size == 0;
+        }
+
+        int pop() {
+            auto position = pending.find_next(cursor);
+            if (position == pending.size())
+                position = pending.find_next(0);
+
+            pending.reset(position);
+            --size;
+            cursor = position + 1;
+            return order[position];
+        }
+
+    private:
+        std::vector<int> order;
+        //indexed by node id + 1
+        std::vector<int> positions;
+        util::bit_vector pending;
+        std::size_t size = 0;
+        std::size_t cursor = 0;
+    };
+
+    //reverse postorder for forward problems, postorder for backward ones, blocks unreachable from ENTRY go last
+    template <InstructionType T>
+    std::vector<int> worklist_order(const FlowGraph<T>& graph, const bool backward) {
+        std::vector<int> order = graph.reverse_postorder();
+
+        for (const auto& node : graph.nodes) {
+            if (!node.removed && graph.rpo_number(node.id) == INVALID)
+                order.push_back(node.id);
+        }
+
+        if (backward)
+            std::ranges::reverse(order);
+
+        return order;
+    }
+}
@@ -1,128 +1,338 @@
 #pragma once
-#include <memory>
+#include <array>
+#include <cstdint>
+#include <span>
 #include <string>
-#include <variant>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 #include "lexer/token.h"
 
 namespace compiler::ir {
+    enum class ir_value_kind : std::uint8_t {
+        None,
+        Constant,
+        Temporary,
+        Variable,
+    };
+
+    //Tagged 8 byte handle, either an immediate or a dense index. Variable names live in symbol_table
     class ir_value {
     private:
-        std::variant<std::string, int> value;
+        ir_value_kind kind = ir_value_kind::None;
+        std::int32_t payload = 0;
+
+        ir_value(const ir_value_kind kind, const std::int32_t payload)
+            : kind(kind),
+              payload(payload) {}
+
+        friend struct ir_instruction;
 
     public:
         ir_value() = default;
 
         explicit ir_value(int i)
-            : value(i) {}
+            : kind(ir_value_kind::Constant),
+              payload(i) {}
+
+        [[nodiscard]] static ir_value temporary(const std::uint32_t index) {
+            return {ir_value_kind::Temporary, static_cast<std::int32_t>(index)};
+        }
 
-        explicit ir_value(const std::string& str)
-            : value(str) {}
+        [[nodiscard]] static ir_value variable(const std::uint32_t index) {
+            return {ir_value_kind::Variable, static_cast<std::int32_t>(index)};
+        }
 
-        template <typename T>
-        [[nodiscard]] const T& get() const {
-            return std::get<T>(value);
+        [[nodiscard]] ir_value_kind get_kind() const {
+            return kind;
         }
 
         [[nodiscard]] bool is_constant() const {
-            return std::holds_alternative<int>(value);
+            return kind == ir_value_kind::Constant;
         }
 
-        [[nodiscard]] std::string value_to_string() const {
-            if (is_constant()) {
-                return std::to_string(get<int>());
-            }
-            return get<std::string>();
+        [[nodiscard]] bool is_temporary() const {
+            return kind == ir_value_kind::Temporary;
+        }
+
+        [[nodiscard]] bool is_variable() const {
+            return kind == ir_value_kind::Variable;
+        }
+
+        [[nodiscard]] int get_constant() const {
+            return payload;
+        }
+
+        [[nodiscard]] std::uint32_t get_index() const {
+            return static_cast<std::uint32_t>(payload);
+        }
+
+        //unique per value, used as hash key
+        [[nodiscard]] std::uint64_t raw() const {
+            return static_cast<std::uint64_t>(kind) << 32 | static_cast<std::uint32_t>(payload);
         }
 
         bool operator==(const ir_value& source) const = default;
     };
 
-    struct ir_return;
-    struct ir_binary;
-    struct ir_unary;
-    struct ir_copy;
-    struct ir_label;
-    struct ir_jump;
-    struct ir_jump_if_zero;
-    struct ir_jump_if_not_zero;
-    struct ir_call;
+    class symbol_table {
+    private:
+        std::vector<std::string> names;
+        std::unordered_map<std::string, std::uint32_t> indices;
 
-    using ir_instruction = std::variant<ir_return, ir_binary, ir_unary, ir_copy, ir_label, ir_jump, ir_jump_if_zero, ir_jump_if_not_zero, ir_call>;
+    public:
+        std::uint32_t intern(const std::string& name) {
+            const auto [it, inserted] = indices.try_emplace(name, static_cast<std::uint32_t>(names.size()));
+            if (inserted)
+                names.push_back(name);
 
-    struct ir_return {
-        ir_value value;
-    };
+            return it->second;
+        }
 
-    struct ir_binary {
-        token_type op;
-        ir_value left;
-        ir_value right;
-        ir_value result;
+        [[nodiscard]] const std::string& name(const std::uint32_t index) const {
+            return names.at(index);
+        }
+
+        [[nodiscard]] std::size_t size() const {
+            return names.size();
+        }
+
+        [[nodiscard]] std::string value_to_string(const ir_value& value) const {
+            switch (value.get_kind()) {
+            case ir_value_kind::Constant:
+                return std::to_string(value.get_constant());
+            case ir_value_kind::Temporary:
+                return "t" + std::to_string(value.get_index());
+            case ir_value_kind::Variable:
+                return name(value.get_index());
+            default:
+                return "<none>";
+            }
+        }
     };
 
-    struct ir_unary {
-        token_type op;
-        ir_value value;
-        ir_value result;
+    enum class ir_opcode : std::uint8_t {
+        Return,
+        Binary,
+        Unary,
+        Copy,
+        Label,
+        Jump,
+        JumpIfZero,
+        JumpIfNotZero,
+        Call,
+        Phi,
     };
 
-    struct ir_copy {
-        ir_value destination;
-        ir_value source;
+    //Fixed size, trivially copyable instruction. Operand kinds and payloads are stored apart so it packs into 20 bytes
+    //  slot 0 (result) - destination of Binary, Unary, Copy and Call
+    //  slot 1 (left)   - left operand, or the single source of Unary, Copy, Return and conditional jumps
+    //  slot 2 (right)  - right operand of Binary
+    //  attribute       - token_type for Binary/Unary, label for Label/jumps, callee symbol for Call
+    //Call arguments and Phi incoming values live in ir_operand_pool, slot 1 and 2 payloads hold their offset and count
+    struct ir_instruction {
+        ir_opcode opcode = ir_opcode::Return;
+        std::array<ir_value_kind, 3> kinds{};
+        std::uint32_t attribute = 0;
+        std::array<std::int32_t, 3> payloads{};
 
-        friend bool operator==(const ir_copy& lhs, const ir_copy& rhs) {
-            return lhs.destination == rhs.destination
-                   && lhs.source == rhs.source;
+        [[nodiscard]] ir_value operand(const std::size_t slot) const {
+            return {kinds[slot], payloads[slot]};
         }
 
-        friend bool operator!=(const ir_copy& lhs, const ir_copy& rhs) {
-            return !(lhs == rhs);
+        void set_operand(const std::size_t slot, const ir_value& value) {
+            kinds[slot] = value.kind;
+            payloads[slot] = value.payload;
         }
-    };
 
-    struct ir_label {
-        std::string name;
-    };
+        [[nodiscard]] ir_value result() const {
+            return operand(0);
+        }
 
-    struct ir_jump {
-        ir_label label;
-    };
+        [[nodiscard]] ir_value left() const {
+            return operand(1);
+        }
 
-    struct ir_jump_if_zero {
-        ir_value condition;
-        ir_label label;
-    };
+        [[nodiscard]] ir_value source() const {
+            return operand(1);
+        }
 
-    struct ir_jump_if_not_zero {
-        ir_value condition;
-        ir_label label;
-    };
+        [[nodiscard]] ir_value right() const {
+            return operand(2);
+        }
+
+        void set_result(const ir_value& value) {
+            set_operand(0, value);
+        }
+
+        void set_left(const ir_value& value) {
+            set_operand(1, value);
+        }
+
+        void set_right(const ir_value& value) {
+            set_operand(2, value);
+        }
+
+        [[nodiscard]] token_type op() const {
+            return static_cast<token_type>(attribute);
+        }
+
+        [[nodiscard]] std::uint32_t label() const {
+            return attribute;
+        }
 
-    struct ir_call {
-        std::string function_name;
-        std::vector<ir_value> arguments;
-        ir_value destination;
+        [[nodiscard]] std::uint32_t callee() const {
+            return attribute;
+        }
+
+        [[nodiscard]] std::uint32_t arguments_offset() const {
+            return static_cast<std::uint32_t>(payloads[1]);
+        }
+
+        [[nodiscard]] std::uint32_t argument_count() const {
+            return static_cast<std::uint32_t>(payloads[2]);
+        }
+
+        [[nodiscard]] bool has_result() const {
+            return opcode == ir_opcode::Binary || opcode == ir_opcode::Unary || opcode == ir_opcode::Copy || opcode == ir_opcode::Call
+                   || opcode == ir_opcode::Phi;
+        }
+
+        //number of value operands read from slot 1 onwards, call arguments and phi incoming values are not included
+        [[nodiscard]] std::size_t source_count() const {
+            switch (opcode) {
+            case ir_opcode::Binary:
+                return 2;
+            case ir_opcode::Unary:
+            case ir_opcode::Copy:
+            case ir_opcode::Return:
+            case ir_opcode::JumpIfZero:
+            case ir_opcode::JumpIfNotZero:
+                return 1;
+            default:
+                return 0;
+            }
+        }
+
+        [[nodiscard]] bool is_conditional_jump() const {
+            return opcode == ir_opcode::JumpIfZero || opcode == ir_opcode::JumpIfNotZero;
+        }
+
+        [[nodiscard]] bool is_jump() const {
+            return opcode == ir_opcode::Jump || is_conditional_jump();
+        }
+
+        bool operator==(const ir_instruction& other) const = default;
     };
 
+    static_assert(sizeof(ir_instruction) == 20);
+    static_assert(std::is_trivially_copyable_v<ir_instruction>);
+
+    [[nodiscard]] inline ir_instruction make_return(const ir_value& value) {
+        ir_instruction instruction{.opcode = ir_opcode::Return};
+        instruction.set_left(value);
+        return instruction;
+    }
+
+    [[nodiscard]] inline ir_instruction make_binary(const token_type op, const ir_value& left, const ir_value& right, const ir_value& result) {
+        ir_instruction instruction{.opcode = ir_opcode::Binary, .attribute = static_cast<std::uint32_t>(op)};
+        instruction.set_result(result);
+        instruction.set_left(left);
+        instruction.set_right(right);
+        return instruction;
+    }
+
+    [[nodiscard]] inline ir_instruction make_unary(const token_type op, const ir_value& value, const ir_value& result) {
+        ir_instruction instruction{.opcode = ir_opcode::Unary, .attribute = static_cast<std::uint32_t>(op)};
+        instruction.set_result(result);
+        instruction.set_left(value);
+        return instruction;
+    }
+
+    [[nodiscard]] inline ir_instruction make_copy(const ir_value& destination, const ir_value& source) {
+        ir_instruction instruction{.opcode = ir_opcode::Copy};
+        instruction.set_result(destination);
+        instruction.set_left(source);
+        return instruction;
+    }
+
+    [[nodiscard]] inline ir_instruction make_label(const std::uint32_t label) {
+        return {.opcode = ir_opcode::Label, .attribute = label};
+    }
+
+    [[nodiscard]] inline ir_instruction make_jump(const std::uint32_t label) {
+        return {.opcode = ir_opcode::Jump, .attribute = label};
+    }
+
+    [[nodiscard]] inline ir_instruction make_jump_if_zero(const ir_value& condition, const std::uint32_t label) {
+        ir_instruction instruction{.opcode = ir_opcode::JumpIfZero, .attribute = label};
+        instruction.set_left(condition);
+        return instruction;
+    }
+
+    [[nodiscard]] inline ir_instruction make_jump_if_not_zero(const ir_value& condition, const std::uint32_t label) {
+        ir_instruction instruction{.opcode = ir_opcode::JumpIfNotZero, .attribute = label};
+        instruction.set_left(condition);
+        return instruction;
+    }
+
+    [[nodiscard]] inline ir_instruction make_call(const std::uint32_t callee, const std::uint32_t arguments_offset, const std::uint32_t argument_count,
+                                                  const ir_value& result) {
+        ir_instruction instruction{.opcode = ir_opcode::Call, .attribute = callee};
+        instruction.set_result(result);
+        instruction.payloads[1] = static_cast<std::int32_t>(arguments_offset);
+        instruction.payloads[2] = static_cast<std::int32_t>(argument_count);
+        return instruction;
+    }
+
+    //incoming values are stored as (value, predecessor block id) pairs, so count is the number of pairs
+    [[nodiscard]] inline ir_instruction make_phi(const ir_value& result, const std::uint32_t incoming_offset, const std::uint32_t incoming_count) {
+        ir_instruction instruction{.opcode = ir_opcode::Phi};
+        instruction.set_result(result);
+        instruction.payloads[1] = static_cast<std::int32_t>(incoming_offset);
+        instruction.payloads[2] = static_cast<std::int32_t>(incoming_count);
+        return instruction;
+    }
+
+    //Side storage for call arguments and phi incoming values, so instructions stay fixed size
+    class ir_operand_pool {
+    private:
+        std::vector<ir_value> values;
 
-    class ir_basic_block {
     public:
-        std::string name;
-        std::vector<ir_instruction> instructions;
+        std::uint32_t append(const std::span<const ir_value> operands) {
+            const auto offset = static_cast<std::uint32_t>(values.size());
+            values.insert(values.end(), operands.begin(), operands.end());
+            return offset;
+        }
+
+        [[nodiscard]] std::span<ir_value> arguments(const ir_instruction& call) {
+            return {values.data() + call.arguments_offset(), call.argument_count()};
+        }
+
+        [[nodiscard]] std::span<const ir_value> arguments(const ir_instruction& call) const {
+            return {values.data() + call.arguments_offset(), call.argument_count()};
+        }
 
-        explicit ir_basic_block(std::string block_name)
-            : name(std::move(block_name)) {}
+        //even entries are the incoming values, odd entries the predecessor block id as a constant
+        [[nodiscard]] std::span<ir_value> incoming(const ir_instruction& phi) {
+            return {values.data() + phi.arguments_offset(), 2 * phi.argument_count()};
+        }
 
-        void add_instruction(ir_instruction inst) {
-            instructions.push_back(std::move(inst));
+        [[nodiscard]] std::span<const ir_value> incoming(const ir_instruction& phi) const {
+            return {values.data() + phi.arguments_offset(), 2 * phi.argument_count()};
         }
+    };
+
+    class ir_basic_block {
+    public:
+        std::vector<ir_instruction> instructions;
 
-        [[nodiscard]] const std::string& get_name() const {
-            return name;
+        void add_instruction(const ir_instruction& inst) {
+            instructions.push_back(inst);
         }
 
-        [[nodiscard]] std::vector<ir_instruction> get_instructions() const {
+        [[nodiscard]] std::span<const ir_instruction> get_instructions() const {
             return instructions;
         }
 
@@ -131,4 +341,60 @@ namespace compiler::ir {
         }
 
     };
+
+    enum class ir_label_kind : std::uint8_t {
+        Else,
+        End,
+        WhileCond,
+        WhileBody,
+        WhileEnd,
+        ShortCircuit,
+        LogicalEnd,
+        Split,
+        Preheader,
+        InlineEnd,
+        TailEntry,
+        Unrolled,
+        Threaded,
+    };
+
+    inline std::string label_kind_to_string(const ir_label_kind kind) {
+        switch (kind) {
+        case ir_label_kind::Else:
+            return "else";
+        case ir_label_kind::End:
+            return "end";
+        case ir_label_kind::WhileCond:
+            return "while_cond";
+        case ir_label_kind::WhileBody:
+            return "while_body";
+        case ir_label_kind::WhileEnd:
+            return "while_end";
+        case ir_label_kind::ShortCircuit:
+            return "short_circuit";
+        case ir_label_kind::LogicalEnd:
+            return "logical_end";
+        case ir_label_kind::Split:
+            return "split";
+        case ir_label_kind::Preheader:
+            return "preheader";
+        case ir_label_kind::InlineEnd:
+            return "inline_end";
+        case ir_label_kind::TailEntry:
+            return "tail_entry";
+        case ir_label_kind::Unrolled:
+            return "unrolled";
+        case ir_label_kind::Threaded:
+            return "threaded";
+        default:
+            return "label";
+        }
+    }
 }
+
+template <>
+struct std::hash<compiler::ir::ir_value> {
+    std::size_t operator()(const compiler::ir::ir_value& value) const noexcept {
+        return std::hash<std::uint64_t>()(value.raw());
+    }
+};
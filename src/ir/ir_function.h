@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ir.h"
+#include "flow_graph/flow_graph.hpp"
+
+namespace compiler::ir {
+    //Labels are dense per function ids, the kind is only kept to render a readable name
+    class ir_function {
+    public:
+        std::uint32_t name;
+        //variables the arguments are bound to, in declaration order
+        std::vector<ir_value> parameters;
+        std::vector<ir_label_kind> labels;
+        FlowGraph<ir_instruction> graph;
+        //made by the optimizer, only calls in the program can reach it
+        bool internal = false;
+
+        explicit ir_function(const std::uint32_t name)
+            : name(name) {}
+
+        std::uint32_t create_label(const ir_label_kind kind) {
+            labels.push_back(kind);
+            return static_cast<std::uint32_t>(labels.size() - 1);
+        }
+
+        [[nodiscard]] std::size_t label_count() const {
+            return labels.size();
+        }
+
+        [[nodiscard]] std::string label_name(const std::uint32_t label) const {
+            return label_kind_to_string(labels.at(label)) + "_" + std::to_string(label);
+        }
+    };
+
+    struct ir_program {
+        symbol_table symbols;
+        ir_operand_pool operands;
+        std::vector<ir_function> functions;
+        //temporaries are numbered across the whole program, passes that create them continue from here
+        std::uint32_t temporary_count = 0;
+
+        ir_value make_temporary() {
+            return ir_value::temporary(temporary_count++);
+        }
+    };
+}
@@ -1,27 +1,63 @@
 #include "ir_generator.h"
 
-//TODO start_new_block
 namespace compiler::ir {
-    std::vector<ir_basic_block> ir_generator::generate(const std::vector<ast::stmt_ptr>& ast) {
-        current_block = ir_basic_block("entry");
+    ir_program ir_generator::generate(const std::vector<ast::stmt_ptr>& ast) {
+        current_function = ir_function{symbols.intern("entry")};
+        current_block = ir_basic_block{};
 
         for (const auto& stmt : ast) {
             process_stmt(stmt);
         }
 
+        finish_function();
+
+        return ir_program{std::move(symbols), std::move(operands), std::move(functions), temp_var_counter};
+    }
+
+    //Keeps blocks basic as they are emitted: a label always opens a block and a jump or return always closes one
+    void ir_generator::emit(const ir_instruction& instruction) {
+        if (!current_block.is_empty()) {
+            const auto& last = current_block.instructions.back();
+            if (last.is_jump() || last.opcode == ir_opcode::Return)
+                flush_block();
+        }
+
+        current_block.add_instruction(instruction);
+    }
+
+    void ir_generator::start_new_block(const std::uint32_t label) {
+        flush_block();
+        current_block.add_instruction(make_label(label));
+    }
+
+    void ir_generator::flush_block() {
         if (!current_block.is_empty())
-            blocks.push_back(current_block);
+            blocks.push_back(std::move(current_block.instructions));
 
-        return blocks;
+        current_block = ir_basic_block{};
     }
 
-    std::string ir_generator::generate_temp() {
-        return "t" + std::to_string(temp_var_counter++);
+    void ir_generator::finish_function() {
+        flush_block();
+
+        if (!blocks.empty()) {
+            current_function.graph.generate_flowgraph(std::move(blocks));
+            functions.push_back(std::move(current_function));
+        }
+
+        blocks.clear();
+    }
+
+    ir_value ir_generator::generate_temp() {
+        return ir_value::temporary(temp_var_counter++);
     }
 
-    std::string ir_generator::get_label(const std::string& label) {
-        static int count = 0;
-        return label + "_" + std::to_string(count++);
+    ir_value ir_generator::make_variable(const std::string& name, const int scope_id) {
+        return ir_value::variable(symbols.intern(name + "_" + std::to_string(scope_id)));
+    }
+
+    std::uint32_t ir_generator::get_label(const ir_label_kind kind) {
+        return current_function.create_label(kind);
     }
 
     void ir_generator::process_stmt(const ast::stmt_ptr& stmt_var) {
@@ -41,7 +77,7 @@ namespace compiler::ir {
     void ir_generator::process_stmt(const ast::return_stmt& ret) {
         // std::cout << "Processing return\n";
         const ir_value return_value = process_expr(*ret.value);
-        current_block.add_instruction(ir_return{return_value});
+        emit(make_return(return_value));
     }
 
     void ir_generator::process_stmt(const ast::expression_stmt& stmt) {
@@ -64,43 +100,40 @@ namespace compiler::ir {
     }
 
     void ir_generator::process_stmt(const ast::if_stmt& stmt) {
-        const std::string else_label = get_label("else");
-        const std::string end_label = get_label("end");
+        const auto else_label = get_label(ir_label_kind::Else);
+        const auto end_label = get_label(ir_label_kind::End);
         const ir_value condition = process_expr(*stmt.condition);
-        current_block.add_instruction(ir_jump_if_zero{condition, else_label});
+        emit(make_jump_if_zero(condition, else_label));
 
         process_stmt(stmt.then_branch);
 
         if (stmt.else_branch.has_value()) {
-            current_block.add_instruction(ir_jump{end_label});
-            current_block.add_instruction(ir_label{else_label});
+            emit(make_jump(end_label));
+            start_new_block(else_label);
             process_stmt(*stmt.else_branch);
-            current_block.add_instruction(ir_label{end_label});
+            start_new_block(end_label);
         } else {
-            current_block.add_instruction(ir_label{else_label});
+            start_new_block(else_label);
         }
     }
 
     void ir_generator::process_stmt(const ast::while_stmt& stmt) {
-        const std::string cond_label = get_label("while_cond");
-        const std::string body_label = get_label("while_body");
-        const std::string end_label = get_label("while_end");
+        const auto cond_label = get_label(ir_label_kind::WhileCond);
+        const auto body_label = get_label(ir_label_kind::WhileBody);
+        const auto end_label = get_label(ir_label_kind::WhileEnd);
 
-        current_block.add_instruction(ir_jump{cond_label});
-        blocks.push_back(current_block);
+        emit(make_jump(cond_label));
 
-        current_block = ir_basic_block{cond_label};
+        start_new_block(cond_label);
         const ir_value condition = process_expr(*stmt.condition);
-        current_block.add_instruction(ir_jump_if_zero{condition, end_label});
-        current_block.add_instruction(ir_jump{body_label});
-        blocks.push_back(current_block);
+        emit(make_jump_if_zero(condition, end_label));
+        emit(make_jump(body_label));
 
-        current_block = ir_basic_block{body_label};
+        start_new_block(body_label);
         process_stmt(stmt.body);
-        current_block.add_instruction(ir_jump{cond_label});
-        blocks.push_back(current_block);
+        emit(make_jump(cond_label));
 
-        current_block = ir_basic_block{end_label};
+        start_new_block(end_label);
     }
 
     ir_value ir_generator::process_expr(const ast::literal_expr& literal) {
@@ -113,24 +146,23 @@ namespace compiler::ir {
         if (!resolved.has_value())
             throw std::runtime_error("Error resolving variable\n");
 
-        const std::string name = variable.name + "_" + std::to_string(resolved.value());
-        return ir_value(name);
+        return make_variable(variable.name, resolved.value());
     }
 
     ir_value ir_generator::process_expr(const ast::binary_expr& expr) {
         const ir_value left = process_expr(*expr.left);
         const ir_value right = process_expr(*expr.right);
-        ir_value result{generate_temp()};
+        const ir_value result = generate_temp();
 
-        current_block.add_instruction(ir_binary{expr.op, left, right, result});
+        emit(make_binary(expr.op, left, right, result));
         return result;
     }
 
     ir_value ir_generator::process_expr(const ast::unary_expr& expr) {
         const ir_value operand = process_expr(*expr.value);
-        ir_value result{generate_temp()};
+        const ir_value result = generate_temp();
 
-        current_block.add_instruction(ir_unary{expr.op, operand, result});
+        emit(make_unary(expr.op, operand, result));
         return result;
     }
 
@@ -144,47 +176,40 @@ namespace compiler::ir {
         if (!resolved.has_value())
             throw std::runtime_error("Undefined variable assignment");
 
-        ir_value destination{expr.name + "_" + std::to_string(resolved.value())};
-        current_block.add_instruction(ir_copy{destination, value});
+        const ir_value destination = make_variable(expr.name, resolved.value());
+        emit(make_copy(destination, value));
         return destination;
     }
 
     ir_value ir_generator::process_expr(const ast::logical_expr& expr) {
-        const std::string short_circuit_label = get_label("short_circuit");
-        const std::string end_label = get_label("logical_end");
+        const auto short_circuit_label = get_label(ir_label_kind::ShortCircuit);
+        const auto end_label = get_label(ir_label_kind::LogicalEnd);
 
         ir_value left = process_expr(*expr.left);
-        ir_value result{generate_temp()};
+        const ir_value result = generate_temp();
 
         if (expr.op == token_type::LogicalAnd) {
-            current_block.add_instruction(ir_jump_if_zero{left, short_circuit_label});
+            emit(make_jump_if_zero(left, short_circuit_label));
 
             ir_value right = process_expr(*expr.right);
-            current_block.add_instruction(ir_copy{result, right});
-            current_block.add_instruction(ir_jump{end_label});
+            emit(make_copy(result, right));
+            emit(make_jump(end_label));
 
-            ir_basic_block short_circuit{short_circuit_label};
-            blocks.push_back(current_block);
-            current_block = short_circuit;
-            current_block.add_instruction(ir_copy{result, ir_value(0)});
-            blocks.push_back(std::move(current_block));
+            start_new_block(short_circuit_label);
+            emit(make_copy(result, ir_value(0)));
 
-            current_block = ir_basic_block{end_label};
+            start_new_block(end_label);
         } else if (expr.op == token_type::LogicalOr) {
-            current_block.add_instruction(ir_jump_if_not_zero{left, short_circuit_label});
+            emit(make_jump_if_not_zero(left, short_circuit_label));
 
             const ir_value right = process_expr(*expr.right);
-            current_block.add_instruction(ir_copy{result, right});
-            current_block.add_instruction(ir_jump{end_label});
-
-            ir_basic_block short_circuit{short_circuit_label};
-            blocks.push_back(current_block);
-            current_block = short_circuit;
+            emit(make_copy(result, right));
+            emit(make_jump(end_label));
 
-            current_block.add_instruction(ir_copy{result, ir_value(1)});
-            blocks.push_back(std::move(current_block));
+            start_new_block(short_circuit_label);
+            emit(make_copy(result, ir_value(1)));
 
-            current_block = ir_basic_block{end_label};
+            start_new_block(end_label);
         }
 
         return result;
@@ -196,9 +221,10 @@ namespace compiler::ir {
             arg_values.push_back(process_expr(*arg));
         }
 
-        ir_value result {generate_temp()};
+        const ir_value result = generate_temp();
 
-        current_block.add_instruction(ir_call{call.identifier, arg_values, result});
+        const auto arguments_offset = operands.append(arg_values);
+        emit(make_call(symbols.intern(call.identifier), arguments_offset, static_cast<std::uint32_t>(arg_values.size()), result));
 
         return result;
     }
@@ -210,20 +236,21 @@ namespace compiler::ir {
     void ir_generator::process_stmt(const ast::function_decl_stmt& func) {
         resolver.begin_scope();
 
+        std::vector<ir_value> parameters;
         for (const auto& param : func.params) {
-            resolver.declare(param.name);
+            const auto scope_id = resolver.declare(param.name);
+            parameters.push_back(make_variable(param.name, scope_id.value()));
         }
 
-        if (!current_block.is_empty()) {
-            blocks.push_back(current_block);
-        }
+        finish_function();
 
-        current_block = ir_basic_block(func.function_name + "_entry");
+        current_function = ir_function{symbols.intern(func.function_name)};
+        current_function.parameters = std::move(parameters);
         process_stmt(func.body);
 
-        blocks.push_back(current_block);
+        finish_function();
         resolver.end_scope();
-        current_block = ir_basic_block("entry");
+        current_function = ir_function{symbols.intern("entry")};
     }
 
     void ir_generator::process_stmt(const ast::variable_stmt& variable) {
@@ -231,8 +258,8 @@ namespace compiler::ir {
 
         if (variable.initializer.has_value()) {
             const auto rhs = process_expr(**variable.initializer);
-            const auto lhs = ir_value{variable.name + "_" + std::to_string(scope_id.value())};
-            current_block.add_instruction(ir_copy{lhs, rhs});
+            const auto lhs = make_variable(variable.name, scope_id.value());
+            emit(make_copy(lhs, rhs));
         } else {
             throw std::runtime_error("Not implemented?");
             // current_block.add_instruction(ir_value{stmt.name}):
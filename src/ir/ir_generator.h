@@ -2,23 +2,38 @@
 #include <print>
 #include <vector>
 #include "ir.h"
+#include "ir_function.h"
 #include "parser/ast.h"
 #include "scope/resolver.hpp"
 
 namespace compiler::ir {
     class ir_generator {
     public:
-        std::vector<ir_basic_block> generate(const std::vector<ast::stmt_ptr>& ast);
+        ir_program generate(const std::vector<ast::stmt_ptr>& ast);
 
     private:
-        std::vector<ir_basic_block> blocks;
-        ir_basic_block current_block{"entry"};
+        std::vector<ir_function> functions;
+        ir_function current_function{0};
+        std::vector<std::vector<ir_instruction> > blocks;
+        ir_basic_block current_block;
         Resolver resolver;
-        int temp_var_counter = 0;
+        symbol_table symbols;
+        ir_operand_pool operands;
+        std::uint32_t temp_var_counter = 0;
 
-        std::string generate_temp();
+        ir_value generate_temp();
 
-        std::string get_label(const std::string& label);
+        ir_value make_variable(const std::string& name, int scope_id);
+
+        std::uint32_t get_label(ir_label_kind kind);
+
+        void emit(const ir_instruction& instruction);
+
+        void start_new_block(std::uint32_t label);
+
+        void flush_block();
+
+        void finish_function();
 
         void process_stmt(const ast::stmt_ptr& stmt_var);
 
@@ -1,108 +1,120 @@
 #pragma once
 #include <format>
+#include <span>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "ir/ir.h"
+#include "ir/ir_function.h"
 
 namespace compiler::ir::printer {
     class ir_printer {
     public:
-        static std::string to_string(const std::vector<ir_basic_block>& blocks) {
+        explicit ir_printer(const ir_program& program)
+            : symbols(program.symbols),
+              operands(program.operands) {}
+
+        [[nodiscard]] std::string to_string(const std::vector<ir_function>& functions) const {
             std::stringstream ss;
-            for (const auto& block : blocks) {
-                ss << block.get_name() << ":\n";
-                ss << to_string(block.get_instructions());
+            for (const auto& function : functions) {
+                ss << to_string(function);
                 ss << "\n";
             }
             return ss.str();
         }
 
+        [[nodiscard]] std::string to_string(const ir_function& function) const {
+            std::stringstream ss;
+            ss << symbols.name(function.name) << ":\n";
+            for (const auto& node : function.graph.nodes) {
+                ss << to_string(node.instructions, function);
+            }
+            return ss.str();
+        }
 
-        static std::string to_string(const std::vector<ir_instruction>& instructions) {
+        [[nodiscard]] std::string to_string(const std::span<const ir_instruction> instructions, const ir_function& function) const {
             std::stringstream ss;
             for (const auto& instruction : instructions) {
-                ss << to_string(instruction) << "\n";
+                ss << to_string(instruction, function) << "\n";
             }
             return ss.str();
         }
 
-        static std::string to_string(const ir_instruction& instruction) {
-            return std::visit([](const auto& instr) -> std::string {
-                return to_string(instr);
-            }, instruction);
+        [[nodiscard]] std::string to_string(const ir_instruction& instruction, const ir_function& function) const {
+            switch (instruction.opcode) {
+            case ir_opcode::Return:
+                return std::format("return {}", value_to_string(instruction.left()));
+            case ir_opcode::Binary:
+                return std::format("{} = {} {} {}",
+                                   value_to_string(instruction.result()),
+                                   value_to_string(instruction.left()),
+                                   token_to_string(instruction.op()),
+                                   value_to_string(instruction.right()));
+            case ir_opcode::Unary:
+                return std::format("{} = {}{}",
+                                   value_to_string(instruction.result()),
+                                   token_to_string(instruction.op()),
+                                   value_to_string(instruction.left()));
+            case ir_opcode::Copy:
+                return std::format("{} = {}",
+                                   value_to_string(instruction.result()),
+                                   value_to_string(instruction.source()));
+            case ir_opcode::Label:
+                return std::format("{}:", function.label_name(instruction.label()));
+            case ir_opcode::Jump:
+                return std::format("jump {}", function.label_name(instruction.label()));
+            case ir_opcode::JumpIfZero:
+                return std::format("jump_if_zero {}, {}",
+                                   value_to_string(instruction.left()),
+                                   function.label_name(instruction.label()));
+            case ir_opcode::JumpIfNotZero:
+                return std::format("jump_if_not_zero {}, {}",
+                                   value_to_string(instruction.left()),
+                                   function.label_name(instruction.label()));
+            case ir_opcode::Call:
+                return call_to_string(instruction);
+            case ir_opcode::Phi:
+                return phi_to_string(instruction);
+            default:
+                return "?";
+            }
         }
 
     private:
-        template <class... Ts>
-        struct overload : Ts... {
-            using Ts::operator()...;
-        };
-
-        static std::string value_to_string(const ir_value& value) {
-            if (value.is_constant())
-                return std::to_string(value.get<int>());
-
-            return value.get<std::string>();
-        }
-
-        static std::string to_string(const ir_return& ret) {
-            return std::format("return {}", value_to_string(ret.value));
-        }
-
-        static std::string to_string(const ir_binary& binary) {
-            return std::format("{} = {} {} {}",
-                               value_to_string(binary.result),
-                               value_to_string(binary.left),
-                               token_to_string(binary.op),
-                               value_to_string(binary.right));
-        }
+        const symbol_table& symbols;
+        const ir_operand_pool& operands;
 
-        static std::string to_string(const ir_unary& unary) {
-            return std::format("{} = {}{}",
-                               value_to_string(unary.result),
-                               token_to_string(unary.op),
-                               value_to_string(unary.value));
+        [[nodiscard]] std::string value_to_string(const ir_value& value) const {
+            return symbols.value_to_string(value);
         }
 
-        static std::string to_string(const ir_copy& copy) {
-            return std::format("{} = {}",
-                               value_to_string(copy.destination),
-                               value_to_string(copy.source));
-        }
-
-        static std::string to_string(const ir_label& label) {
-            return std::format("{}:", label.name);
-        }
-
-        static std::string to_string(const ir_jump& jump) {
-            return std::format("jump {}", jump.label.name);
-        }
-
-        static std::string to_string(const ir_jump_if_zero& jump) {
-            return std::format("jump_if_zero {}, {}",
-                               value_to_string(jump.condition),
-                               jump.label.name);
-        }
+        [[nodiscard]] std::string call_to_string(const ir_instruction& call) const {
+            std::string args;
+            const auto arguments = operands.arguments(call);
+            for (size_t i = 0; i < arguments.size(); i++) {
+                if (i > 0) {
+                    args += ", ";
+                }
+                args += value_to_string(arguments[i]);
+            }
 
-        static std::string to_string(const ir_jump_if_not_zero& jump) {
-            return std::format("jump_if_not_zero {}, {}",
-                               value_to_string(jump.condition),
-                               jump.label.name);
+            return std::format("{} = call {}( {} )", value_to_string(call.result()), symbols.name(call.callee()), args);
         }
 
-        static std::string to_string(const ir_call& call) {
-            std::string args;
-            for (size_t i = 0; i < call.arguments.size(); i++) {
+        [[nodiscard]] std::string phi_to_string(const ir_instruction& phi) const {
+            std::string incoming_values;
+            const auto incoming = operands.incoming(phi);
+            for (size_t i = 0; i < incoming.size(); i += 2) {
                 if (i > 0) {
-                    args += ", ";
+                    incoming_values += ", ";
                 }
-                args += value_to_string(call.arguments[i]);
+                incoming_values += std::format("[{}, {}]", value_to_string(incoming[i]), incoming[i + 1].get_constant());
             }
 
-            return std::format("{} = call {}( {} )", value_to_string(call.destination), call.function_name, args);
+            return std::format("{} = phi( {} )", value_to_string(phi.result()), incoming_values);
         }
+
         static std::string token_to_string(const token_type type) {
             switch (type) {
             case token_type::Plus:
@@ -113,6 +125,10 @@ namespace compiler::ir::printer {
                 return "*";
             case token_type::Slash:
                 return "/";
+            case token_type::LessLess:
+                return "<<";
+            case token_type::GreaterGreater:
+                return ">>";
             case token_type::LogicalAnd:
                 return "&&";
             case token_type::LogicalOr:
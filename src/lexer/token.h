@@ -34,6 +34,9 @@ enum class token_type {
     Pipe,
     Caret,
     Tilde,
+    //only produced by the optimizer, arithmetic shifts by a constant
+    LessLess,
+    GreaterGreater,
 
     PlusEqual,
     MinusEqual,
@@ -0,0 +1,123 @@
+#include "call_graph.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace compiler {
+    void CallGraph::build(const ir::ir_program& program) {
+        const auto count = program.functions.size();
+        indices.clear();
+        edges.assign(count, {});
+        self_calls.assign(count, false);
+
+        //top level code is split into several functions named entry, nothing can call them
+        for (std::size_t i = 0; i < count; ++i)
+            indices.try_emplace(program.functions[i].name, i);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            for (const auto& node : program.functions[i].graph.nodes) {
+                for (const auto& instruction : node.instructions) {
+                    if (instruction.opcode != ir::ir_opcode::Call)
+                        continue;
+
+                    const auto callee = function_index(instruction.callee());
+                    if (!callee.has_value())
+                        continue;
+
+                    if (*callee == i)
+                        self_calls[i] = true;
+
+                    if (!std::ranges::contains(edges[i], *callee))
+                        edges[i].push_back(*callee);
+                }
+            }
+        }
+
+        find_components();
+    }
+
+    std::optional<std::size_t> CallGraph::function_index(const std::uint32_t name) const {
+        const auto it = indices.find(name);
+        if (it == indices.end())
+            return {};
+
+        return it->second;
+    }
+
+    const std::vector<std::size_t>& CallGraph::callees(const std::size_t function) const {
+        return edges[function];
+    }
+
+    const std::vector<std::size_t>& CallGraph::bottom_up() const {
+        return order;
+    }
+
+    bool CallGraph::is_recursive(const std::size_t caller, const std::size_t callee) const {
+        return components[caller] == components[callee] && (caller != callee || self_calls[caller]);
+    }
+
+    //Tarjan's algorithm, it finishes a component only after every component it calls into, which is the bottom up order
+    void CallGraph::find_components() {
+        constexpr auto UNVISITED = std::numeric_limits<std::size_t>::max();
+        const auto count = edges.size();
+
+        order.clear();
+        components.assign(count, UNVISITED);
+        std::vector<std::size_t> discovery(count, UNVISITED);
+        std::vector<std::size_t> low_link(count, 0);
+        std::vector<bool> on_stack(count, false);
+        std::vector<std::size_t> stack;
+        std::size_t counter = 0;
+        std::size_t component_count = 0;
+
+        struct Frame {
+            std::size_t function;
+            std::size_t next_edge;
+        };
+
+        for (std::size_t root = 0; root < count; ++root) {
+            if (discovery[root] != UNVISITED)
+                continue;
+
+            std::vector<Frame> frames{{root, 0}};
+            discovery[root] = low_link[root] = counter++;
+            stack.push_back(root);
+            on_stack[root] = true;
+
+            while (!frames.empty()) {
+                auto& frame = frames.back();
+                const auto function = frame.function;
+
+                if (frame.next_edge < edges[function].size()) {
+                    const auto callee = edges[function][frame.next_edge++];
+                    if (discovery[callee] == UNVISITED) {
+                        discovery[callee] = low_link[callee] = counter++;
+                        stack.push_back(callee);
+                        on_stack[callee] = true;
+                        frames.push_back({callee, 0});
+                    } else if (on_stack[callee]) {
+                        low_link[function] = std::min(low_link[function], discovery[callee]);
+                    }
+                    continue;
+                }
+
+                frames.pop_back();
+                if (!frames.empty())
+                    low_link[frames.back().function] = std::min(low_link[frames.back().function], low_link[function]);
+
+                if (low_link[function] != discovery[function])
+                    continue;
+
+                std::size_t member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    on_stack[member] = false;
+                    components[member] = component_count;
+                    order.push_back(member);
+                } while (member != function);
+                ++component_count;
+            }
+        }
+    }
+}
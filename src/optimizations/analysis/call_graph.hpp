@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "ir/ir_function.h"
+
+namespace compiler {
+    //Calls between the functions of a program, by index into ir_program::functions. Calls to functions without a
+    //body are left out. Functions calling each other, directly or through others, form one component
+    class CallGraph {
+    public:
+        void build(const ir::ir_program& program);
+
+        [[nodiscard]] std::optional<std::size_t> function_index(std::uint32_t name) const;
+
+        [[nodiscard]] const std::vector<std::size_t>& callees(std::size_t function) const;
+
+        //callees before their callers, the functions of a recursive component next to each other
+        [[nodiscard]] const std::vector<std::size_t>& bottom_up() const;
+
+        //true when calling callee from caller can lead back to caller, a function calling itself included
+        [[nodiscard]] bool is_recursive(std::size_t caller, std::size_t callee) const;
+
+    private:
+        std::unordered_map<std::uint32_t, std::size_t> indices;
+        std::vector<std::vector<std::size_t> > edges;
+        std::vector<std::size_t> order;
+        std::vector<std::size_t> components;
+        //functions of a component of one that call themselves
+        std::vector<bool> self_calls;
+
+        void find_components();
+    };
+}
@@ -0,0 +1,89 @@
+#include "liveness.hpp"
+
+namespace compiler {
+    void Liveness::compute(const FlowGraphType& graph, const ir::ir_operand_pool& operands, const SideEffects& side_effects) {
+        this->operands = &operands;
+        number_values(graph);
+
+        //globals outlive the function and the callee of any call may read them
+        globals = util::bit_vector(indices.size());
+        for (const auto& [value, index] : indices) {
+            if (side_effects.is_global(value))
+                globals.set(index);
+        }
+
+        dataflow.solve(graph, indices.size(), globals, [this](const NodeType& node, util::bit_vector& gen, util::bit_vector& kill) {
+            for (auto it = node.instructions.rbegin(); it != node.instructions.rend(); ++it) {
+                if (it->has_result()) {
+                    const auto index = indices.at(it->result());
+                    gen.reset(index);
+                    kill.set(index);
+                }
+
+                if (it->opcode == ir::ir_opcode::Call)
+                    gen |= globals;
+
+                for_each_use(*it, [&](const ir::ir_value& value) {
+                    if (const auto index = index_of(value))
+                        gen.set(*index);
+                });
+            }
+        });
+    }
+
+    const util::bit_vector& Liveness::live_in(const int node_id) const {
+        return dataflow.in_of(node_id);
+    }
+
+    const util::bit_vector& Liveness::live_out(const int node_id) const {
+        return dataflow.out_of(node_id);
+    }
+
+    std::optional<std::uint32_t> Liveness::index_of(const ir::ir_value& value) const {
+        const auto it = indices.find(value);
+        if (it == indices.end())
+            return {};
+
+        return it->second;
+    }
+
+    bool Liveness::is_live(const ir::ir_value& value, const util::bit_vector& live) const {
+        const auto index = index_of(value);
+        return index.has_value() && live.test(*index);
+    }
+
+    void Liveness::step(const ir::ir_instruction& instruction, util::bit_vector& live) const {
+        if (instruction.has_result())
+            live.reset(indices.at(instruction.result()));
+
+        if (instruction.opcode == ir::ir_opcode::Call)
+            live |= globals;
+
+        for_each_use(instruction, [&](const ir::ir_value& value) {
+            if (const auto index = index_of(value))
+                live.set(*index);
+        });
+    }
+
+    void Liveness::number_values(const FlowGraphType& graph) {
+        indices.clear();
+
+        for (const auto& node : graph.nodes) {
+            for (const auto& instruction : node.instructions) {
+                if (instruction.has_result())
+                    add_value(instruction.result());
+
+                for_each_use(instruction, [this](const ir::ir_value& value) {
+                    add_value(value);
+                });
+            }
+        }
+    }
+
+    void Liveness::add_value(const ir::ir_value& value) {
+        if (value.is_constant() || value.get_kind() == ir::ir_value_kind::None)
+            return;
+
+        indices.try_emplace(value, static_cast<std::uint32_t>(indices.size()));
+    }
+}
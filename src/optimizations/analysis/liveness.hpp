@@ -0,0 +1,59 @@
+#pragma once
+#include <optional>
+#include <unordered_map>
+#include "flow_graph/dataflow.hpp"
+#include "flow_graph/flow_graph.hpp"
+#include "ir/ir.h"
+#include "side_effects.hpp"
+#include "util/bit_vector.h"
+
+namespace compiler {
+    //Backward liveness of temporaries and variables. Block sets come from the dataflow solver, the state inside a block
+    //is rebuilt by walking it bottom up from live_out with step. Globals are live at exit and read by every call
+    class Liveness {
+    public:
+        using FlowGraphType = FlowGraph<ir::ir_instruction>;
+        using NodeType = Node<ir::ir_instruction>;
+
+        void compute(const FlowGraphType& graph, const ir::ir_operand_pool& operands, const SideEffects& side_effects);
+
+        [[nodiscard]] const util::bit_vector& live_in(int node_id) const;
+
+        [[nodiscard]] const util::bit_vector& live_out(int node_id) const;
+
+        [[nodiscard]] std::optional<std::uint32_t> index_of(const ir::ir_value& value) const;
+
+        [[nodiscard]] bool is_live(const ir::ir_value& value, const util::bit_vector& live) const;
+
+        //turns the values live after the instruction into the values live before it
+        void step(const ir::ir_instruction& instruction, util::bit_vector& live) const;
+
+    private:
+        const ir::ir_operand_pool* operands = nullptr;
+        std::unordered_map<ir::ir_value, std::uint32_t> indices;
+        util::bit_vector globals;
+        Dataflow<ir::ir_instruction> dataflow{DataflowDirection::Backward, DataflowMeet::Union};
+
+        void number_values(const FlowGraphType& graph);
+
+        void add_value(const ir::ir_value& value);
+
+        template <typename F>
+        void for_each_use(const ir::ir_instruction& instruction, F&& f) const {
+            for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot)
+                f(instruction.operand(slot));
+
+            if (instruction.opcode == ir::ir_opcode::Call) {
+                for (const auto& argument : operands->arguments(instruction))
+                    f(argument);
+            }
+
+            //phi values are really read on the incoming edges, counting them at the phi only keeps them live longer
+            if (instruction.opcode == ir::ir_opcode::Phi) {
+                const auto incoming = operands->incoming(instruction);
+                for (std::size_t i = 0; i < incoming.size(); i += 2)
+                    f(incoming[i]);
+            }
+        }
+    };
+}
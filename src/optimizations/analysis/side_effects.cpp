@@ -0,0 +1,78 @@
+#include "side_effects.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace compiler {
+    void SideEffects::compute(const ir::ir_program& program) {
+        globals.clear();
+        pure_functions.clear();
+
+        //top level statements are collected in functions named entry, there can be several of them
+        for (const auto& function : program.functions) {
+            if (program.symbols.name(function.name) != "entry")
+                continue;
+
+            for (const auto& node : function.graph.nodes) {
+                for (const auto& instruction : node.instructions) {
+                    if (instruction.has_result() && instruction.result().is_variable())
+                        globals.insert(instruction.result());
+                }
+            }
+        }
+
+        std::vector<const ir::ir_function*> candidates;
+        for (const auto& function : program.functions) {
+            if (program.symbols.name(function.name) != "entry" && !writes_global(function.graph) && !has_cycle(function.graph))
+                candidates.push_back(&function);
+        }
+
+        //starts from nothing pure, so recursive functions never qualify since they can not be proven to return
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (const auto* function : candidates) {
+                if (pure_functions.contains(function->name))
+                    continue;
+
+                const bool calls_pure_only = std::ranges::all_of(function->graph.nodes, [this](const auto& node) {
+                    return node.removed || std::ranges::all_of(node.instructions, [this](const ir::ir_instruction& instruction) {
+                        return instruction.opcode != ir::ir_opcode::Call || pure_functions.contains(instruction.callee());
+                    });
+                });
+
+                if (calls_pure_only) {
+                    pure_functions.insert(function->name);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    bool SideEffects::is_global(const ir::ir_value& value) const {
+        return globals.contains(value);
+    }
+
+    bool SideEffects::is_pure(const std::uint32_t function) const {
+        return pure_functions.contains(function);
+    }
+
+    bool SideEffects::writes_global(const FlowGraphType& graph) const {
+        return std::ranges::any_of(graph.nodes, [this](const auto& node) {
+            return !node.removed && std::ranges::any_of(node.instructions, [this](const ir::ir_instruction& instruction) {
+                return instruction.has_result() && is_global(instruction.result());
+            });
+        });
+    }
+
+    //a back edge in reverse postorder means a loop, irreducible ones included
+    bool SideEffects::has_cycle(const FlowGraphType& graph) {
+        for (const auto id : graph.reverse_postorder()) {
+            for (const auto successor : graph.get_node_from_id(id).successors) {
+                if (successor != EXIT && graph.rpo_number(successor) <= graph.rpo_number(id))
+                    return true;
+            }
+        }
+        return false;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <unordered_set>
+#include "flow_graph/flow_graph.hpp"
+#include "ir/ir.h"
+#include "ir/ir_function.h"
+
+namespace compiler {
+    //Program wide facts about what outlives a function. Variables defined at top level are globals, any function can
+    //read or write them. A function is pure when it writes no global, always returns (no cycles and no recursion) and
+    //only calls pure functions, so a call to it whose result is unused can be dropped
+    class SideEffects {
+    public:
+        using FlowGraphType = FlowGraph<ir::ir_instruction>;
+
+        void compute(const ir::ir_program& program);
+
+        [[nodiscard]] bool is_global(const ir::ir_value& value) const;
+
+        [[nodiscard]] bool is_pure(std::uint32_t function) const;
+
+    private:
+        std::unordered_set<ir::ir_value> globals;
+        std::unordered_set<std::uint32_t> pure_functions;
+
+        bool writes_global(const FlowGraphType& graph) const;
+
+        static bool has_cycle(const FlowGraphType& graph);
+    };
+}
@@ -1,47 +1,82 @@
 #pragma once
-#include <vector>
+#include <memory>
 #include "flow_graph/flow_graph.hpp"
 #include "ir/ir.h"
+#include "ir/ir_function.h"
+#include "pass_manager.hpp"
+#include "passes/conditional_constant_propagation.hpp"
 #include "passes/constant_folding.hpp"
 #include "passes/copy_propagation.hpp"
+#include "passes/dead_code_elimination.hpp"
+#include "passes/dead_function_elimination.hpp"
+#include "passes/induction_variables.hpp"
+#include "passes/instruction_combining.hpp"
+#include "passes/interprocedural_constants.hpp"
+#include "passes/jump_threading.hpp"
+#include "passes/inliner.hpp"
+#include "passes/loop_invariant_code_motion.hpp"
+#include "passes/loop_unrolling.hpp"
+#include "passes/ssa_construction.hpp"
+#include "passes/ssa_destruction.hpp"
+#include "passes/tail_recursion.hpp"
+#include "passes/unreachable_code_elem.hpp"
+#include "passes/value_numbering.hpp"
 
-//TODO rework this probably
 namespace compiler {
     class Optimizer {
     private:
-        ConstantFolding folding;
-        CopyPropagation copy_propagation;
-        FlowGraph<ir::ir_instruction> graph;
+        PassManager pipeline;
 
     public:
-        Optimizer() = default;
+        Optimizer()
+            : pipeline(default_pipeline()) {}
 
-        std::vector<ir::ir_basic_block> optimize(const std::vector<ir::ir_basic_block>& blocks) {
-            std::vector<ir::ir_basic_block> optimized_blocks;
-
-            for (const auto& block : blocks) {
-                bool changed;
-                int limit = 0;
-                do {
-                    changed = false;
-                    auto block_instructions = block.get_instructions();
-                    graph.generate_flowgraph(block_instructions);
-
-                    //todo bug with infinite loop, forced to do limit
-                    changed |= folding.apply(block_instructions);
-                    changed |= copy_propagation.apply(graph);
-                    limit++;
+        explicit Optimizer(PassManager pipeline)
+            : pipeline(std::move(pipeline)) {}
 
+        //Passes update the function graph in place, so it is only built once by the IR generator.
+        //Constant arguments move into their callees first, while every call still passes what the source wrote, and
+        //the clones made for them are dropped at the end once inlining left them unused.
+        //The function is in SSA form between construction and destruction, the inliner rebuilds it and tail recursion
+        //assigns parameters, so both run before. Jump threading rebuilds it as well, it runs before construction and
+        //again after destruction for the blocks the copies were split into. Loops are unrolled once they are simplified, the copies are then
+        //cleaned up by another round of the scalar passes
+        static PassManager default_pipeline() {
+            PassManager pipeline;
+            pipeline.add(std::make_unique<InterproceduralConstants>());
+            pipeline.add(std::make_unique<Inliner>());
+            pipeline.add(std::make_unique<TailRecursion>());
+            pipeline.add(std::make_unique<JumpThreading>());
+            pipeline.add(std::make_unique<SsaConstruction>());
+            pipeline.add_fixpoint(scalar_passes());
+            pipeline.add(std::make_unique<LoopUnrolling>());
+            pipeline.add_fixpoint(scalar_passes());
+            pipeline.add(std::make_unique<SsaDestruction>());
+            pipeline.add(std::make_unique<JumpThreading>());
+            pipeline.add(std::make_unique<DeadFunctionElimination>());
+            return pipeline;
+        }
 
-                } while (changed && limit < 25);
+        static std::vector<std::unique_ptr<Pass> > scalar_passes() {
+            std::vector<std::unique_ptr<Pass> > scalar;
+            scalar.push_back(std::make_unique<ConditionalConstantPropagation>());
+            scalar.push_back(std::make_unique<ConstantFolding>());
+            scalar.push_back(std::make_unique<InstructionCombining>());
+            scalar.push_back(std::make_unique<GlobalValueNumbering>());
+            scalar.push_back(std::make_unique<CopyPropagation>());
+            scalar.push_back(std::make_unique<DeadCodeElimination>());
+            scalar.push_back(std::make_unique<LoopInvariantCodeMotion>());
+            scalar.push_back(std::make_unique<InductionVariables>());
+            scalar.push_back(std::make_unique<UnreachableCode>());
+            return scalar;
+        }
 
-                const auto optimized_instructions = graph.emit_instructions();
-                ir::ir_basic_block optimized_block = block;
-                optimized_block.instructions = optimized_instructions;
-                optimized_blocks.push_back(optimized_block);
-            }
+        void optimize(ir::ir_program& program) {
+            pipeline.run(program);
+        }
 
-            return optimized_blocks;
+        [[nodiscard]] const std::vector<FunctionMetrics>& metrics() const {
+            return pipeline.metrics();
         }
     };
 }
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include "ir/ir_function.h"
+
+namespace compiler {
+    class AnalysisManager;
+
+    //Analyses a pass reads, the pass manager has them ready before the pass runs
+    enum class Analysis : std::uint8_t {
+        None = 0,
+        Cfg = 1 << 0,
+        Dominators = 1 << 1,
+        Liveness = 1 << 2,
+        Loops = 1 << 3,
+    };
+
+    //What a pass modified, decides which cached analyses are dropped after it. A pass only reports what it really
+    //changed, a fixpoint group stops at the first round where every pass returns None
+    enum class Changes : std::uint8_t {
+        None = 0,
+        Rewritten = 1 << 0,
+        Removed = 1 << 1,
+        Inserted = 1 << 2,
+        Cfg = 1 << 3,
+        Instructions = Rewritten | Removed | Inserted,
+    };
+
+    constexpr Analysis operator|(const Analysis left, const Analysis right) {
+        return static_cast<Analysis>(static_cast<std::uint8_t>(left) | static_cast<std::uint8_t>(right));
+    }
+
+    constexpr bool operator&(const Analysis left, const Analysis right) {
+        return (static_cast<std::uint8_t>(left) & static_cast<std::uint8_t>(right)) != 0;
+    }
+
+    constexpr Changes operator|(const Changes left, const Changes right) {
+        return static_cast<Changes>(static_cast<std::uint8_t>(left) | static_cast<std::uint8_t>(right));
+    }
+
+    constexpr Changes& operator|=(Changes& left, const Changes right) {
+        return left = left | right;
+    }
+
+    constexpr bool operator&(const Changes left, const Changes right) {
+        return (static_cast<std::uint8_t>(left) & static_cast<std::uint8_t>(right)) != 0;
+    }
+
+    struct PassContext {
+        ir::ir_program& program;
+        AnalysisManager& analyses;
+    };
+
+    class Pass {
+    public:
+        virtual ~Pass() = default;
+
+        [[nodiscard]] virtual std::string_view name() const = 0;
+
+        [[nodiscard]] virtual Analysis required_analyses() const {
+            return Analysis::None;
+        }
+
+        virtual Changes apply(ir::ir_function& function, PassContext& context) = 0;
+    };
+
+    //A pass over the whole program at once, for work that has to see every call. It may add and remove functions,
+    //the program wide analyses are rebuilt after one changes something
+    class ProgramPass {
+    public:
+        virtual ~ProgramPass() = default;
+
+        [[nodiscard]] virtual std::string_view name() const = 0;
+
+        virtual Changes apply(ir::ir_program& program, AnalysisManager& analyses) = 0;
+    };
+}
@@ -0,0 +1,144 @@
+#include "pass_manager.hpp"
+
+#include <algorithm>
+#include <ranges>
+
+namespace compiler {
+    void AnalysisManager::set_program(const ir::ir_program& program) {
+        this->program = &program;
+        side_effects_result.compute(program);
+        call_graph_result.build(program);
+    }
+
+    void AnalysisManager::set_function(ir::ir_function& function, const ir::ir_program& program) {
+        if (this->program != &program)
+            set_program(program);
+
+        this->function = &function;
+        liveness_valid = false;
+    }
+
+    void AnalysisManager::prepare(const Analysis analyses) {
+        if (analyses & Analysis::Cfg)
+            (void) function->graph.reverse_postorder();
+
+        if (analyses & Analysis::Dominators)
+            (void) dominators();
+
+        if (analyses & Analysis::Loops)
+            (void) loops();
+
+        if (analyses & Analysis::Liveness)
+            (void) liveness();
+    }
+
+    void AnalysisManager::invalidate(const Changes changes) {
+        if (changes & Changes::Cfg)
+            function->graph.invalidate_analyses();
+
+        if (changes & (Changes::Cfg | Changes::Instructions))
+            liveness_valid = false;
+    }
+
+    const DominatorTree& AnalysisManager::dominators() const {
+        return function->graph.dominators();
+    }
+
+    const LoopInfo& AnalysisManager::loops() const {
+        return function->graph.loops();
+    }
+
+    const Liveness& AnalysisManager::liveness() {
+        if (!liveness_valid) {
+            liveness_result.compute(function->graph, program->operands, side_effects_result);
+            liveness_valid = true;
+        }
+        return liveness_result;
+    }
+
+    PassManager& PassManager::add(std::unique_ptr<Pass> pass) {
+        std::vector<std::unique_ptr<Pass> > passes;
+        passes.push_back(std::move(pass));
+        stages.push_back({std::move(passes), 1, false});
+        return *this;
+    }
+
+    PassManager& PassManager::add(std::unique_ptr<ProgramPass> pass) {
+        stages.push_back({{}, 1, false, std::move(pass)});
+        return *this;
+    }
+
+    PassManager& PassManager::add_fixpoint(std::vector<std::unique_ptr<Pass> > passes, const int max_iterations) {
+        stages.push_back({std::move(passes), max_iterations, true});
+        return *this;
+    }
+
+    void PassManager::run(ir::ir_program& program) {
+        function_metrics.clear();
+
+        analyses.set_program(program);
+        auto stage = stages.begin();
+        while (stage != stages.end()) {
+            if (stage->program_pass) {
+                if (stage->program_pass->apply(program, analyses) != Changes::None)
+                    analyses.set_program(program);
+                ++stage;
+                continue;
+            }
+
+            const auto end = std::find_if(stage, stages.end(), [](const Stage& next) {
+                return next.program_pass != nullptr;
+            });
+            for (const auto index : analyses.call_graph().bottom_up())
+                run(program.functions[index], program, stage, end);
+            stage = end;
+
+            //calls were inlined or removed, the call graph is stale
+            analyses.set_program(program);
+        }
+    }
+
+    void PassManager::run(ir::ir_function& function, ir::ir_program& program) {
+        run(function, program, stages.begin(), stages.end());
+    }
+
+    void PassManager::run(ir::ir_function& function, ir::ir_program& program, const std::vector<Stage>::iterator first,
+                          const std::vector<Stage>::iterator last) {
+        analyses.set_function(function, program);
+        FunctionMetrics metrics{function.name};
+
+        for (auto& stage : std::ranges::subrange(first, last)) {
+            if (stage.program_pass)
+                continue;
+
+            Changes changes = Changes::None;
+            for (int iteration = 0; iteration < stage.max_iterations; ++iteration) {
+                changes = Changes::None;
+                for (const auto& pass : stage.passes)
+                    changes |= run_pass(*pass, function, program);
+
+                metrics.changes |= changes;
+                if (stage.fixpoint)
+                    ++metrics.iterations;
+
+                if (changes == Changes::None)
+                    break;
+            }
+
+            if (stage.fixpoint && changes != Changes::None)
+                metrics.converged = false;
+        }
+
+        function_metrics.push_back(metrics);
+    }
+
+    Changes PassManager::run_pass(Pass& pass, ir::ir_function& function, ir::ir_program& program) {
+        analyses.prepare(pass.required_analyses());
+
+        PassContext context{program, analyses};
+        const auto changes = pass.apply(function, context);
+
+        analyses.invalidate(changes);
+        return changes;
+    }
+}
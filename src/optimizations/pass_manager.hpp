@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "analysis/call_graph.hpp"
+#include "analysis/liveness.hpp"
+#include "analysis/side_effects.hpp"
+#include "ir/ir_function.h"
+#include "pass.hpp"
+
+namespace compiler {
+    //Per function cache of the analyses passes ask for. Dominators and loops are cached by the FlowGraph itself,
+    //this only decides when to drop them: instruction changes keep them, CFG changes drop everything.
+    //Side effects and the call graph are program wide and computed once when the program is set
+    class AnalysisManager {
+    public:
+        void set_program(const ir::ir_program& program);
+
+        void set_function(ir::ir_function& function, const ir::ir_program& program);
+
+        void prepare(Analysis analyses);
+
+        void invalidate(Changes changes);
+
+        [[nodiscard]] const DominatorTree& dominators() const;
+
+        [[nodiscard]] const LoopInfo& loops() const;
+
+        [[nodiscard]] const Liveness& liveness();
+
+        [[nodiscard]] const SideEffects& side_effects() const {
+            return side_effects_result;
+        }
+
+        [[nodiscard]] const CallGraph& call_graph() const {
+            return call_graph_result;
+        }
+
+    private:
+        ir::ir_function* function = nullptr;
+        const ir::ir_program* program = nullptr;
+        bool liveness_valid = false;
+        Liveness liveness_result;
+        SideEffects side_effects_result;
+        CallGraph call_graph_result;
+    };
+
+    //What the pipeline did to one function. Iterations count the rounds of every fixpoint group, the last round
+    //that found nothing to change included
+    struct FunctionMetrics {
+        std::uint32_t function;
+        int iterations = 0;
+        //false when a fixpoint group was still changing the function at its iteration limit
+        bool converged = true;
+        Changes changes = Changes::None;
+    };
+
+    //Runs a pipeline of stages over every function. A stage is one pass, or a group of passes repeated
+    //until none of them reports a change. Functions are visited callees first, so a caller sees optimized callees.
+    //A program pass splits the pipeline, every function goes through the stages before it first. Program passes
+    //only run when a whole program is run
+    class PassManager {
+    public:
+        PassManager& add(std::unique_ptr<Pass> pass);
+
+        PassManager& add(std::unique_ptr<ProgramPass> pass);
+
+        PassManager& add_fixpoint(std::vector<std::unique_ptr<Pass> > passes, int max_iterations = 25);
+
+        void run(ir::ir_program& program);
+
+        void run(ir::ir_function& function, ir::ir_program& program);
+
+        //one entry per function run since the last run over a whole program
+        [[nodiscard]] const std::vector<FunctionMetrics>& metrics() const {
+            return function_metrics;
+        }
+
+    private:
+        struct Stage {
+            std::vector<std::unique_ptr<Pass> > passes;
+            int max_iterations;
+            bool fixpoint;
+            //set instead of the passes for a program pass
+            std::unique_ptr<ProgramPass> program_pass;
+        };
+
+        std::vector<Stage> stages;
+        AnalysisManager analyses;
+        std::vector<FunctionMetrics> function_metrics;
+
+        void run(ir::ir_function& function, ir::ir_program& program, std::vector<Stage>::iterator first, std::vector<Stage>::iterator last);
+
+        Changes run_pass(Pass& pass, ir::ir_function& function, ir::ir_program& program);
+    };
+}
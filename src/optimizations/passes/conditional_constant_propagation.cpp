@@ -0,0 +1,340 @@
+#include "conditional_constant_propagation.hpp"
+
+#include <algorithm>
+#include "constant_folding.hpp"
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes ConditionalConstantPropagation::apply(ir::ir_function& function, PassContext& context) {
+        graph = &function.graph;
+        operands = &context.program.operands;
+
+        initialize(context.analyses.side_effects());
+        solve();
+        return rewrite(context.program.operands);
+    }
+
+    void ConditionalConstantPropagation::initialize(const SideEffects& side_effects) {
+        lattice.clear();
+        uses.clear();
+        flow_worklist.clear();
+        value_worklist.clear();
+
+        const auto slots = static_cast<std::size_t>(graph->max_node_id()) + 2;
+        executable_blocks = util::bit_vector(slots);
+        executable_predecessors.assign(slots, {});
+
+        std::unordered_map<ir::ir_value, int> definition_counts;
+        for (const auto& node : graph->nodes) {
+            if (node.removed)
+                continue;
+
+            for (std::uint32_t index = 0; index < node.instructions.size(); ++index) {
+                const auto& instruction = node.instructions[index];
+                const InstructionRef reference{node.id, index};
+                const auto add_use = [&](const ir::ir_value& value) {
+                    if (!value.is_constant())
+                        uses[value].push_back(reference);
+                };
+
+                for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot)
+                    add_use(instruction.operand(slot));
+
+                if (instruction.opcode == ir::ir_opcode::Phi) {
+                    const auto incoming = operands->incoming(instruction);
+                    for (std::size_t i = 0; i < incoming.size(); i += 2)
+                        add_use(incoming[i]);
+                }
+
+                if (instruction.has_result())
+                    ++definition_counts[instruction.result()];
+            }
+        }
+
+        //values missing from the lattice are overdefined
+        for (const auto& [value, count] : definition_counts) {
+            if (count == 1 && !side_effects.is_global(value))
+                lattice.emplace(value, LatticeValue{});
+        }
+    }
+
+    void ConditionalConstantPropagation::solve() {
+        executable_blocks.set(ENTRY + 1);
+        for (const auto successor : graph->get_node_from_id(ENTRY).successors)
+            mark_edge(ENTRY, successor);
+
+        while (!flow_worklist.empty() || !value_worklist.empty()) {
+            while (!flow_worklist.empty()) {
+                const auto [from, to] = flow_worklist.back();
+                flow_worklist.pop_back();
+
+                auto& predecessors = executable_predecessors[to + 1];
+                if (std::ranges::contains(predecessors, from))
+                    continue;
+                predecessors.push_back(from);
+
+                const auto& node = graph->get_node_from_id(to);
+                const bool first_visit = !executable_blocks.test(to + 1);
+                executable_blocks.set(to + 1);
+
+                //a new edge into a known block can only change its phis
+                for (std::uint32_t index = 0; index < node.instructions.size(); ++index) {
+                    const auto opcode = node.instructions[index].opcode;
+                    if (!first_visit && opcode != ir::ir_opcode::Label && opcode != ir::ir_opcode::Phi)
+                        break;
+
+                    visit({to, index});
+                }
+
+                if (first_visit && (node.instructions.empty() || !node.instructions.back().is_jump())) {
+                    for (const auto successor : node.successors)
+                        mark_edge(to, successor);
+                }
+            }
+
+            if (!value_worklist.empty()) {
+                const auto reference = value_worklist.back();
+                value_worklist.pop_back();
+                visit(reference);
+            }
+        }
+    }
+
+    void ConditionalConstantPropagation::mark_edge(const int from, const int to) {
+        flow_worklist.emplace_back(from, to);
+    }
+
+    void ConditionalConstantPropagation::visit(const InstructionRef& reference) {
+        if (!executable_blocks.test(reference.block + 1))
+            return;
+
+        const auto& node = graph->get_node_from_id(reference.block);
+        const auto& instruction = node.instructions[reference.index];
+
+        if (instruction.is_jump()) {
+            visit_terminator(node, &instruction);
+            return;
+        }
+
+        if (instruction.has_result())
+            lower(instruction.result(), evaluate(node, instruction));
+    }
+
+    void ConditionalConstantPropagation::visit_terminator(const NodeType& node, const ir::ir_instruction* last) {
+        const auto condition = last->is_conditional_jump() ? value_of(last->source()) : LatticeValue{State::Bottom};
+
+        //an unknown condition only happens without a reaching definition, both ways stay possible then
+        if (condition.state != State::Constant) {
+            for (const auto successor : node.successors)
+                mark_edge(node.id, successor);
+            return;
+        }
+
+        const bool taken = last->opcode == ir::ir_opcode::JumpIfZero ? condition.constant == 0 : condition.constant != 0;
+        const auto target = graph->label_to_block_id(last->label());
+        for (const auto successor : node.successors) {
+            if ((successor == target) == taken)
+                mark_edge(node.id, successor);
+        }
+
+        //both edges lead to the same block
+        if (std::ranges::all_of(node.successors, [target](const int successor) { return successor == target; }))
+            mark_edge(node.id, target);
+    }
+
+    ConditionalConstantPropagation::LatticeValue ConditionalConstantPropagation::evaluate(const NodeType& node, const ir::ir_instruction& instruction) const {
+        switch (instruction.opcode) {
+        case ir::ir_opcode::Copy:
+            return value_of(instruction.source());
+        case ir::ir_opcode::Unary: {
+            const auto operand = value_of(instruction.left());
+            if (operand.state != State::Constant)
+                return operand;
+
+            const auto result = ConstantFolding::evaluate_unary(instruction.op(), operand.constant);
+            return result.has_value() ? LatticeValue{State::Constant, *result} : LatticeValue{State::Bottom};
+        }
+        case ir::ir_opcode::Binary: {
+            const auto left = value_of(instruction.left());
+            const auto right = value_of(instruction.right());
+            if (left.state == State::Bottom || right.state == State::Bottom)
+                return {State::Bottom};
+
+            if (left.state == State::Top || right.state == State::Top)
+                return {};
+
+            const auto result = ConstantFolding::evaluate_binary(instruction.op(), left.constant, right.constant);
+            return result.has_value() ? LatticeValue{State::Constant, *result} : LatticeValue{State::Bottom};
+        }
+        case ir::ir_opcode::Phi: {
+            //only values flowing in over executable edges count
+            LatticeValue result;
+            const auto& predecessors = executable_predecessors[node.id + 1];
+            const auto incoming = operands->incoming(instruction);
+            for (std::size_t i = 0; i < incoming.size(); i += 2) {
+                if (std::ranges::contains(predecessors, incoming[i + 1].get_constant()))
+                    result = meet(result, value_of(incoming[i]));
+            }
+            return result;
+        }
+        default:
+            return {State::Bottom};
+        }
+    }
+
+    ConditionalConstantPropagation::LatticeValue ConditionalConstantPropagation::value_of(const ir::ir_value& value) const {
+        if (value.is_constant())
+            return {State::Constant, value.get_constant()};
+
+        const auto it = lattice.find(value);
+        return it == lattice.end() ? LatticeValue{State::Bottom} : it->second;
+    }
+
+    void ConditionalConstantPropagation::lower(const ir::ir_value& value, const LatticeValue& new_value) {
+        const auto it = lattice.find(value);
+        if (it == lattice.end())
+            return;
+
+        //values only ever move down the lattice, which bounds the work
+        const auto merged = meet(it->second, new_value);
+        if (merged == it->second)
+            return;
+
+        it->second = merged;
+        if (const auto value_uses = uses.find(value); value_uses != uses.end())
+            value_worklist.insert(value_worklist.end(), value_uses->second.begin(), value_uses->second.end());
+    }
+
+    Changes ConditionalConstantPropagation::rewrite(ir::ir_operand_pool& operands) {
+        Changes changes = Changes::None;
+
+        std::vector<int> unreachable;
+        for (auto& node : graph->nodes) {
+            if (node.removed || node.id == ENTRY || node.id == EXIT)
+                continue;
+
+            if (!executable_blocks.test(node.id + 1)) {
+                unreachable.push_back(node.id);
+                continue;
+            }
+
+            if (rewrite_block(node, operands))
+                changes |= Changes::Rewritten;
+
+            changes |= fold_branch(node);
+        }
+
+        for (const auto id : unreachable)
+            graph->remove_node(id);
+
+        if (!unreachable.empty()) {
+            graph->compact();
+            changes |= Changes::Cfg | Changes::Removed;
+        }
+
+        return changes;
+    }
+
+    bool ConditionalConstantPropagation::rewrite_block(NodeType& node, ir::ir_operand_pool& operands) {
+        bool changed = false;
+        const auto substitute = [&](ir::ir_value& value) {
+            const auto known = value_of(value);
+            if (known.state == State::Constant && !value.is_constant()) {
+                value = ir::ir_value{known.constant};
+                changed = true;
+            }
+        };
+
+        for (auto& instruction : node.instructions) {
+            for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot) {
+                auto operand = instruction.operand(slot);
+                substitute(operand);
+                instruction.set_operand(slot, operand);
+            }
+
+            if (instruction.opcode == ir::ir_opcode::Call) {
+                for (auto& argument : operands.arguments(instruction))
+                    substitute(argument);
+            }
+
+            if (instruction.opcode == ir::ir_opcode::Phi) {
+                //incoming values from edges that never execute are dropped, the edges go away with their blocks
+                const auto& predecessors = executable_predecessors[node.id + 1];
+                auto incoming = operands.incoming(instruction);
+                std::vector<ir::ir_value> kept;
+                for (std::size_t i = 0; i < incoming.size(); i += 2) {
+                    if (!std::ranges::contains(predecessors, incoming[i + 1].get_constant()))
+                        continue;
+
+                    substitute(incoming[i]);
+                    kept.push_back(incoming[i]);
+                    kept.push_back(incoming[i + 1]);
+                }
+
+                if (kept.size() == 2) {
+                    instruction = ir::make_copy(instruction.result(), kept.front());
+                    changed = true;
+                } else if (!kept.empty() && kept.size() != incoming.size()) {
+                    instruction = ir::make_phi(instruction.result(), operands.append(kept), static_cast<std::uint32_t>(kept.size() / 2));
+                    changed = true;
+                }
+            }
+
+            //copies already had their source replaced above
+            const auto opcode = instruction.opcode;
+            if (opcode == ir::ir_opcode::Binary || opcode == ir::ir_opcode::Unary || opcode == ir::ir_opcode::Phi) {
+                const auto known = value_of(instruction.result());
+                if (known.state == State::Constant) {
+                    instruction = ir::make_copy(instruction.result(), ir::ir_value{known.constant});
+                    changed = true;
+                }
+            }
+        }
+
+        return changed;
+    }
+
+    Changes ConditionalConstantPropagation::fold_branch(NodeType& node) {
+        if (node.instructions.empty() || !node.instructions.back().is_conditional_jump())
+            return Changes::None;
+
+        auto& last = node.instructions.back();
+        const auto condition = value_of(last.source());
+        if (condition.state != State::Constant)
+            return Changes::None;
+
+        const bool taken = last.opcode == ir::ir_opcode::JumpIfZero ? condition.constant == 0 : condition.constant != 0;
+        const auto target = graph->label_to_block_id(last.label());
+        auto fallthrough = target;
+        for (const auto successor : node.successors) {
+            if (successor != target)
+                fallthrough = successor;
+        }
+
+        Changes changes = Changes::Cfg;
+        if (taken) {
+            last = ir::make_jump(last.label());
+            changes |= Changes::Rewritten;
+        } else {
+            node.instructions.pop_back();
+            changes |= Changes::Removed;
+        }
+
+        //the edge that is left is added back once, it may have been there twice
+        const auto kept = taken ? target : fallthrough;
+        graph->remove_edge(node.id, target);
+        graph->remove_edge(node.id, fallthrough);
+        graph->add_edge(node.id, kept);
+        return changes;
+    }
+
+    ConditionalConstantPropagation::LatticeValue ConditionalConstantPropagation::meet(const LatticeValue& left, const LatticeValue& right) {
+        if (left.state == State::Top)
+            return right;
+
+        if (right.state == State::Top || left == right)
+            return left;
+
+        return {State::Bottom};
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "flow_graph/flow_graph.hpp"
+#include "ir/ir.h"
+#include "ir/ir_function.h"
+#include "optimizations/analysis/side_effects.hpp"
+#include "optimizations/pass.hpp"
+#include "util/bit_vector.h"
+#include "util/small_vector.h"
+
+namespace compiler {
+    //Sparse conditional constant propagation (Wegman-Zadeck). Values and CFG edges are solved together: a block is
+    //only evaluated once an edge into it is executable, and a conditional jump on a known value only marks the edge it
+    //takes. Afterwards constants replace their uses, known branches become jumps or fall through and blocks that were
+    //never reached are deleted. Only single definition values that are not globals are tracked, the rest is overdefined
+    class ConditionalConstantPropagation : public Pass {
+    public:
+        using FlowGraphType = FlowGraph<ir::ir_instruction>;
+        using NodeType = Node<ir::ir_instruction>;
+
+        [[nodiscard]] std::string_view name() const override {
+            return "conditional-constant-propagation";
+        }
+
+        [[nodiscard]] Analysis required_analyses() const override {
+            return Analysis::Cfg;
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
+
+    private:
+        //Top is not known yet, Bottom can hold more than one value at runtime
+        struct LatticeValue {
+            enum class State : std::uint8_t {
+                Top,
+                Constant,
+                Bottom,
+            };
+
+            State state = State::Top;
+            int constant = 0;
+
+            bool operator==(const LatticeValue& other) const = default;
+        };
+
+        using State = LatticeValue::State;
+
+        struct InstructionRef {
+            int block;
+            std::uint32_t index;
+        };
+
+        FlowGraphType* graph = nullptr;
+        const ir::ir_operand_pool* operands = nullptr;
+        std::unordered_map<ir::ir_value, LatticeValue> lattice;
+        std::unordered_map<ir::ir_value, std::vector<InstructionRef> > uses;
+        util::bit_vector executable_blocks;
+        //indexed by block id + 1
+        std::vector<util::small_vector<int, 2> > executable_predecessors;
+        std::vector<std::pair<int, int> > flow_worklist;
+        std::vector<InstructionRef> value_worklist;
+
+        void initialize(const SideEffects& side_effects);
+
+        void solve();
+
+        void mark_edge(int from, int to);
+
+        void visit(const InstructionRef& reference);
+
+        void visit_terminator(const NodeType& node, const ir::ir_instruction* last);
+
+        [[nodiscard]] LatticeValue evaluate(const NodeType& node, const ir::ir_instruction& instruction) const;
+
+        [[nodiscard]] LatticeValue value_of(const ir::ir_value& value) const;
+
+        void lower(const ir::ir_value& value, const LatticeValue& new_value);
+
+        Changes rewrite(ir::ir_operand_pool& operands);
+
+        bool rewrite_block(NodeType& node, ir::ir_operand_pool& operands);
+
+        Changes fold_branch(NodeType& node);
+
+        static LatticeValue meet(const LatticeValue& left, const LatticeValue& right);
+    };
+}
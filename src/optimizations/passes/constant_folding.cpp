@@ -1,59 +1,63 @@
 #include "constant_folding.hpp"
 
+#include <limits>
+
 namespace compiler {
-    //TODO this might need to be node not blocks, check later
-    bool ConstantFolding::apply(std::vector<ir::ir_instruction> &instructions) {
-        bool changed = false;
+    Changes ConstantFolding::apply(ir::ir_function& function, PassContext&) {
+        Changes changes = Changes::None;
 
-        for (const auto& instruction : instructions) {
-            changed |= process_instruction(instruction);
+        for (auto& node : function.graph.nodes) {
+            for (auto& instruction : node.instructions) {
+                const auto folded = fold_instruction(instruction);
+                if (folded.has_value()) {
+                    instruction = folded.value();
+                    changes = Changes::Rewritten;
+                }
+            }
         }
 
-        if (changed)
-            instructions = std::move(new_instructions);
-
-        return changed;
+        return changes;
     }
 
     std::optional<int> ConstantFolding::get_constant_value(const ir::ir_value& val) {
         if (val.is_constant())
-            return val.get<int>();
+            return val.get_constant();
 
         return std::nullopt;
     }
 
-    bool ConstantFolding::process_instruction(const ir::ir_instruction& inst) {
-        const auto new_inst = std::visit([](auto& i) {
-            return fold_instruction(i);
-        }, inst);
-        if (new_inst.has_value()) {
-            new_instructions.emplace_back(new_inst.value());
-            return true;
+    std::optional<ir::ir_instruction> ConstantFolding::fold_instruction(const ir::ir_instruction& inst) {
+        switch (inst.opcode) {
+        case ir::ir_opcode::Binary:
+            return fold_binary(inst);
+        case ir::ir_opcode::Unary:
+            return fold_unary(inst);
+        default:
+            return std::nullopt;
         }
-        return false;
     }
 
-    std::optional<ir::ir_instruction> ConstantFolding::fold_instruction(const ir::ir_binary& inst) {
-        const auto left = get_constant_value(inst.left);
-        const auto right = get_constant_value(inst.right);
+    std::optional<ir::ir_instruction> ConstantFolding::fold_binary(const ir::ir_instruction& inst) {
+        const auto left = get_constant_value(inst.left());
+        const auto right = get_constant_value(inst.right());
 
         if (left && right) {
-            const auto result = evaluate_binary(inst.op, left.value(), right.value());
+            const auto result = evaluate_binary(inst.op(), left.value(), right.value());
 
             if (result.has_value()) {
-                return ir::ir_copy{inst.result, ir::ir_value{result.value()}};
+                return ir::make_copy(inst.result(), ir::ir_value{result.value()});
             }
         }
         return std::nullopt;
     }
 
-    std::optional<ir::ir_instruction> ConstantFolding::fold_instruction(const ir::ir_unary& inst) {
-        const auto constant = get_constant_value(inst.value);
+    std::optional<ir::ir_instruction> ConstantFolding::fold_unary(const ir::ir_instruction& inst) {
+        const auto constant = get_constant_value(inst.left());
         if (constant) {
-            auto result = evaluate_unary(inst.op, constant.value());
+            auto result = evaluate_unary(inst.op(), constant.value());
 
             if (result.has_value()) {
-                return ir::ir_copy{inst.result, ir::ir_value{result.value()}};
+                return ir::make_copy(inst.result(), ir::ir_value{result.value()});
             }
         }
         return std::nullopt;
@@ -82,7 +86,17 @@ namespace compiler {
         case token_type::Star:
             return left * right;
         case token_type::Slash:
+            if (right == 0 || (left == std::numeric_limits<int>::min() && right == -1))
+                return std::nullopt;
             return left / right;
+        case token_type::LessLess:
+            if (right < 0 || right > 31)
+                return std::nullopt;
+            return static_cast<int>(static_cast<unsigned>(left) << right);
+        case token_type::GreaterGreater:
+            if (right < 0 || right > 31)
+                return std::nullopt;
+            return left >> right;
         case token_type::NotEqual:
             return left != right ? 1 : 0;
         case token_type::EqualEqual:
@@ -1,34 +1,35 @@
 #pragma once
+#include "flow_graph/flow_graph.hpp"
 #include "ir/ir.h"
 #include "lexer/token.h"
+#include "optimizations/pass.hpp"
 
 
 namespace compiler {
-    class ConstantFolding {
+    class ConstantFolding : public Pass {
     public:
-        bool apply(std::vector<ir::ir_instruction> &instructions);
+        using FlowGraphType = FlowGraph<ir::ir_instruction>;
 
-    private:
-        std::vector<ir::ir_instruction> new_instructions;
-
-        static std::optional<int> get_constant_value(const ir::ir_value& val);
-
-        //default case for every instruction we don't handle
-        template <typename T>
-        static std::optional<ir::ir_instruction> fold_instruction(T&) {
-            return std::nullopt;
+        [[nodiscard]] std::string_view name() const override {
+            return "constant-folding";
         }
 
-        bool process_instruction(const ir::ir_instruction& inst);
+        Changes apply(ir::ir_function& function, PassContext& context) override;
 
+        //nullopt when the operator is not supported or the result is undefined, like a division by zero
         //TODO add support for jump_if_zero jump_if_not_zero
         static std::optional<int> evaluate_unary(token_type op, int value);
 
         static std::optional<int> evaluate_binary(token_type op, int left, int right);
 
-        static std::optional<ir::ir_instruction> fold_instruction(const ir::ir_binary& inst);
+    private:
+        static std::optional<int> get_constant_value(const ir::ir_value& val);
+
+        static std::optional<ir::ir_instruction> fold_instruction(const ir::ir_instruction& inst);
+
+        static std::optional<ir::ir_instruction> fold_binary(const ir::ir_instruction& inst);
 
-        static std::optional<ir::ir_instruction> fold_instruction(const ir::ir_unary& inst);
+        static std::optional<ir::ir_instruction> fold_unary(const ir::ir_instruction& inst);
     };
 }
 
@@ -1,227 +1,187 @@
 #include "copy_propagation.hpp"
 
 #include <algorithm>
-#include <deque>
-#include <ranges>
 #include <stdexcept>
+#include "optimizations/pass_manager.hpp"
 
 namespace compiler {
-    bool CopyPropagation::apply(FlowGraphType& graph) {
-        bool changed = false;
+    Changes CopyPropagation::apply(ir::ir_function& function, PassContext& context) {
+        auto& graph = function.graph;
+        auto& operands = context.program.operands;
+        Changes changes = Changes::None;
+        side_effects = &context.analyses.side_effects();
         find_reaching_copies(graph);
 
         for (auto& node : graph.nodes) {
-            std::vector<ir::ir_instruction> instructions_to_keep;
-
-            for (size_t i = 0; i < node.instructions.size(); ++i) {
-                const auto& instruction = node.instructions[i];
-                auto reaching_copies = get_instruction_annotations(node.id, i);
-
-                auto instr_copy = instruction;
-                const auto new_instruction = std::visit([this, &reaching_copies](auto& instr) {
-                    return this->rewrite_instruction(instr, reaching_copies);
-                }, instr_copy);
-                //TODO bug, when we don't rewrite the instruction, we still receive the value, so this will infinite loop
-                if (new_instruction.has_value()) {
-                    instructions_to_keep.emplace_back(new_instruction.value());
-                    changed = true;
-                }
-            }
-            node.instructions = std::move(instructions_to_keep);
-        }
-        return changed;
-    }
-
-    void CopyPropagation::find_reaching_copies(FlowGraphType& graph) {
-        const auto all_copies = find_all_copy_instr(graph);
-        std::deque<int> worklist;
-
-        for (const auto& node : graph.nodes) {
-            if (node.id == ENTRY || node.id == EXIT)
+            if (node.id == ENTRY || node.id == EXIT || node.removed)
                 continue;
 
-            worklist.push_back(node.id);
-            annotate_block(node, all_copies);
-        }
-
-        while (!worklist.empty()) {
-            const auto block_id = worklist.front();
-            worklist.pop_front();
+            //reaching copies are replayed through the block instead of being stored per instruction
+            auto reaching = reaching_copies.in_of(node.id);
+            //compact in place, kept instructions are shifted down over the deleted ones
+            std::size_t kept = 0;
 
-            auto block = graph.get_node_from_id(block_id);
-            auto old_annotation = get_block_annotation(block.id);
-            auto incoming_copies = meet(block, all_copies);
-            transfer(block, incoming_copies);
+            for (size_t i = 0; i < node.instructions.size(); ++i) {
+                const auto instruction = node.instructions[i];
 
-            if (old_annotation != get_block_annotation(block_id)) {
-                for (auto successor_id : block.successors) {
-                    if (successor_id == EXIT)
-                        continue;
+                if (instruction.opcode == ir::ir_opcode::Call) {
+                    if (rewrite_arguments(instruction, reaching, operands))
+                        changes |= Changes::Rewritten;
+                    node.instructions[kept++] = instruction;
+                    transfer(instruction, reaching);
+                    continue;
+                }
 
-                    if (successor_id == ENTRY)
-                        throw std::runtime_error("Malformed control graph");
+                const auto new_instruction = rewrite_instruction(instruction, reaching);
+                transfer(instruction, reaching);
 
-                    if (!std::ranges::contains(worklist, successor_id))
-                        worklist.push_back(successor_id);
+                if (!new_instruction.has_value()) {
+                    changes |= Changes::Removed;
+                    continue;
                 }
-            }
-        }
-    }
 
-    //todo simplify this with ranges probably
-    std::vector<ir::ir_copy> CopyPropagation::find_all_copy_instr(const FlowGraphType& graph) {
-        std::vector<ir::ir_copy> result;
-        for (const auto& node : graph.nodes) {
-            for (const auto& instr : node.instructions) {
-                if (std::holds_alternative<ir::ir_copy>(instr)) {
-                    auto copy = std::get<ir::ir_copy>(instr);
-                    result.emplace_back(copy);
-                }
+                if (new_instruction.value() != instruction)
+                    changes |= Changes::Rewritten;
+                node.instructions[kept++] = new_instruction.value();
             }
+            node.instructions.resize(kept);
         }
-
-        return result;
+        return changes;
     }
 
+    void CopyPropagation::find_reaching_copies(const FlowGraphType& graph) {
+        collect_copies(graph);
 
-    std::vector<ir::ir_copy> CopyPropagation::meet(const NodeType& node, const std::vector<ir::ir_copy>& all_copies) {
-        std::vector<ir::ir_copy> incoming_copies = all_copies;
-
-        for (const auto predecessor_id : node.predecessors) {
-            if (predecessor_id == ENTRY)
-                return {};
-
-            if (predecessor_id == EXIT)
-                throw std::runtime_error("Malformed control flow");
+        reaching_copies.solve(graph, copies.size(), util::bit_vector(copies.size()),
+                              [this](const NodeType& node, util::bit_vector& gen, util::bit_vector& kill) {
+                                  for (const auto& instruction : node.instructions) {
+                                      if (writes_globals(instruction)) {
+                                          gen.subtract(global_copies);
+                                          kill |= global_copies;
+                                      }
 
-            auto predecessor_copies = get_block_annotation(predecessor_id);
+                                      if (!instruction.has_result())
+                                          continue;
 
-            auto intersection = incoming_copies | std::views::filter([&](const ir::ir_copy& copy) -> bool {
-                return contains_instruction(predecessor_copies, copy);
-            }) | std::ranges::to<std::vector<ir::ir_copy> >();
+                                      if (const auto it = copies_touching.find(instruction.result()); it != copies_touching.end()) {
+                                          gen.subtract(it->second);
+                                          kill |= it->second;
+                                      }
 
-            incoming_copies = std::move(intersection);
-        }
-        return incoming_copies;
+                                      if (instruction.opcode == ir::ir_opcode::Copy)
+                                          gen.set(copy_index(instruction));
+                                  }
+                              });
     }
 
-    bool CopyPropagation::contains_instruction(const std::vector<ir::ir_copy>& copy_instructions, const ir::ir_copy& copy_instruction) {
-        return std::ranges::any_of(copy_instructions, [&copy_instruction](const ir::ir_copy& instr) {
-            return instr.source == copy_instruction.source && instr.destination == copy_instruction.destination;
-        });
-    }
+    void CopyPropagation::collect_copies(const FlowGraphType& graph) {
+        copies.clear();
+        copies_touching.clear();
+        copies_by_result.clear();
 
-    void CopyPropagation::annotate_instruction(int block_id, size_t instr_index,
-                                               const std::vector<ir::ir_copy>& reaching_copies) {
-        annotated_instructions[{block_id, instr_index}] = reaching_copies;
-    }
+        for (const auto& node : graph.nodes) {
+            for (const auto& instruction : node.instructions) {
+                if (instruction.opcode != ir::ir_opcode::Copy)
+                    continue;
 
-    std::vector<ir::ir_copy> CopyPropagation::get_instruction_annotations(int block_id, size_t instr_index) {
-        const auto it = annotated_instructions.find({block_id, instr_index});
-        if (it != annotated_instructions.end())
-            return it->second;
+                auto& same_result = copies_by_result[instruction.result()];
+                const bool known = std::ranges::any_of(same_result, [&](const std::uint32_t index) {
+                    return copies[index].source() == instruction.source();
+                });
 
-        throw std::runtime_error("get_instruction_annotation on unknown instruction");
-    }
+                if (!known) {
+                    same_result.push_back(static_cast<std::uint32_t>(copies.size()));
+                    copies.push_back(instruction);
+                }
+            }
+        }
 
-    void CopyPropagation::annotate_block(const NodeType& node, const std::vector<ir::ir_copy>& reaching_copies) {
-        annotated_blocks[node.id] = reaching_copies;
-    }
+        global_copies = util::bit_vector(copies.size());
+        for (std::size_t i = 0; i < copies.size(); ++i) {
+            for (const auto& value : {copies[i].result(), copies[i].source()}) {
+                auto [it, inserted] = copies_touching.try_emplace(value, copies.size());
+                it->second.set(i);
 
-    std::vector<ir::ir_copy> CopyPropagation::get_block_annotation(int node_id) {
-        const auto it = annotated_blocks.find(node_id);
+                if (side_effects->is_global(value))
+                    global_copies.set(i);
+            }
+        }
+    }
 
-        if (it != annotated_blocks.end())
-            return it->second;
+    std::uint32_t CopyPropagation::copy_index(const ir::ir_instruction& copy) const {
+        for (const auto index : copies_by_result.at(copy.result())) {
+            if (copies[index].source() == copy.source())
+                return index;
+        }
 
-        throw std::runtime_error("Trying to get not annotated block");
+        throw std::runtime_error("Copy was not collected");
     }
 
-    void CopyPropagation::kill_copies(std::vector<ir::ir_copy>& reaching_copies, const ir::ir_value& value) {
-        std::erase_if(reaching_copies, [&](const ir::ir_copy& copy) -> bool {
-            return copy.source == value || copy.destination == value;
-        });
+    //the callee can assign any global, whether or not this function does
+    bool CopyPropagation::writes_globals(const ir::ir_instruction& instruction) const {
+        return instruction.opcode == ir::ir_opcode::Call && !side_effects->is_pure(instruction.callee());
     }
 
-    //Computes block reaching copies
-    void CopyPropagation::transfer(NodeType& node, std::vector<ir::ir_copy>& initial_reaching_copies) {
-        auto current_reaching_copies = initial_reaching_copies;
+    void CopyPropagation::transfer(const ir::ir_instruction& instruction, util::bit_vector& reaching) const {
+        if (writes_globals(instruction))
+            reaching.subtract(global_copies);
 
-        for (size_t i = 0; i < node.instructions.size(); ++i) {
-            const auto& instruction = node.instructions[i];
-            annotate_instruction(node.id, i, current_reaching_copies);
+        if (!instruction.has_result())
+            return;
 
-            if (std::holds_alternative<ir::ir_copy>(instruction)) {
-                const auto copy = std::get<ir::ir_copy>(instruction);
-
-                if (contains_instruction(current_reaching_copies, copy))
-                    continue;
-
-                kill_copies(current_reaching_copies, copy.destination);
-                current_reaching_copies.push_back(copy);
-            }
-
-            if (std::holds_alternative<ir::ir_unary>(instruction)) {
-                const auto unary = std::get<ir::ir_unary>(instruction);
-                kill_copies(current_reaching_copies, unary.result);
-            }
-
-            if (std::holds_alternative<ir::ir_binary>(instruction)) {
-                const auto binary = std::get<ir::ir_binary>(instruction);
-                kill_copies(current_reaching_copies, binary.result);
-            }
+        if (const auto it = copies_touching.find(instruction.result()); it != copies_touching.end())
+            reaching.subtract(it->second);
 
-            if (std::holds_alternative<ir::ir_call>(instruction)) {
-                const auto call = std::get<ir::ir_call>(instruction);
-                kill_copies(current_reaching_copies, call.destination);
-            }
-
-        }
-
-        annotate_block(node, current_reaching_copies);
+        if (instruction.opcode == ir::ir_opcode::Copy)
+            reaching.set(copy_index(instruction));
     }
 
-    ir::ir_value CopyPropagation::replace_operand(ir::ir_value& operand, std::vector<ir::ir_copy>& reaching_copies) {
+    ir::ir_value CopyPropagation::replace_operand(const ir::ir_value& operand, const util::bit_vector& reaching) const {
         if (operand.is_constant())
             return operand;
 
-        for (const auto& [destination, source] : reaching_copies) {
-            if (destination == operand)
-                return source;
+        const auto it = copies_by_result.find(operand);
+        if (it == copies_by_result.end())
+            return operand;
+
+        for (const auto index : it->second) {
+            if (reaching.test(index))
+                return copies[index].source();
         }
 
         return operand;
     }
 
-
-    std::optional<ir::ir_instruction> CopyPropagation::rewrite_instruction(ir::ir_copy& copy, std::vector<ir::ir_copy>& reaching_copies) {
-        for (const auto& reaching_copy : reaching_copies) {
-            //delete
-            bool tmp = reaching_copy.source == copy.destination && reaching_copy.destination == copy.source;
-            if (reaching_copy == copy || tmp)
+    std::optional<ir::ir_instruction> CopyPropagation::rewrite_instruction(const ir::ir_instruction& instruction,
+                                                                         const util::bit_vector& reaching) const {
+        if (instruction.opcode == ir::ir_opcode::Copy) {
+            //delete, the same copy already holds
+            if (reaching.test(copy_index(instruction)))
                 return {};
-        }
 
-        const auto new_source = replace_operand(copy.source, reaching_copies);
-        return ir::ir_copy{copy.destination, new_source};
-    }
+            //delete, the reversed copy holds so both sides are already equal
+            if (const auto it = copies_by_result.find(instruction.source()); it != copies_by_result.end()) {
+                for (const auto index : it->second) {
+                    if (reaching.test(index) && copies[index].source() == instruction.result())
+                        return {};
+                }
+            }
+        }
 
-    std::optional<ir::ir_instruction> CopyPropagation::rewrite_instruction(ir::ir_unary& unary, std::vector<ir::ir_copy>& reaching_copies) {
-        const auto new_source = replace_operand(unary.value, reaching_copies);
-        return ir::ir_unary{unary.op, new_source, unary.result};
-    }
+        auto rewritten = instruction;
+        for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot)
+            rewritten.set_operand(slot, replace_operand(instruction.operand(slot), reaching));
 
-    std::optional<ir::ir_instruction> CopyPropagation::rewrite_instruction(ir::ir_binary& binary, std::vector<ir::ir_copy>& reaching_copies) {
-        const auto new_source1 = replace_operand(binary.left, reaching_copies);
-        const auto new_source2 = replace_operand(binary.right, reaching_copies);
-        return ir::ir_binary{binary.op, new_source1, new_source2, binary.result};
+        return rewritten;
     }
 
-    std::optional<ir::ir_instruction> CopyPropagation::rewrite_instruction(ir::ir_call& call, std::vector<ir::ir_copy>& reaching_copies) {
-        std::vector<ir::ir_value> new_args;
-        for (auto& arg : call.arguments) {
-            new_args.push_back(replace_operand(arg,reaching_copies));
+    bool CopyPropagation::rewrite_arguments(const ir::ir_instruction& call, const util::bit_vector& reaching, ir::ir_operand_pool& operands) const {
+        bool changed = false;
+        for (auto& argument : operands.arguments(call)) {
+            const auto replaced = replace_operand(argument, reaching);
+            changed |= replaced != argument;
+            argument = replaced;
         }
-        return ir::ir_call{call.function_name, new_args, call.destination};
+        return changed;
     }
 }
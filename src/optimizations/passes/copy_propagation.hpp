@@ -1,61 +1,51 @@
 #pragma once
+#include "flow_graph/dataflow.hpp"
 #include "flow_graph/flow_graph.hpp"
+#include "optimizations/analysis/side_effects.hpp"
+#include "optimizations/pass.hpp"
+#include "util/bit_vector.h"
 
 namespace compiler {
-    class CopyPropagation {
+    class CopyPropagation : public Pass {
     public:
         using FlowGraphType = FlowGraph<ir::ir_instruction>;
         using NodeType = Node<ir::ir_instruction>;
 
-        bool apply(FlowGraphType& graph);
-
-    private:
-        // TODO rethink this shit, I don't like it
-        using InstructionKey = std::pair<int, size_t>; // <block_id, instruction_index>
-        struct PairHash {
-            std::size_t operator()(const InstructionKey& p) const {
-                return std::hash<int>()(p.first) ^ (std::hash<size_t>()(p.second) << 1);
-            }
-        };
-
-        std::unordered_map<InstructionKey, std::vector<ir::ir_copy>, PairHash> annotated_instructions;
-        std::unordered_map<int, std::vector<ir::ir_copy> > annotated_blocks;
-
-        void find_reaching_copies(FlowGraphType& graph);
-
-        static std::vector<ir::ir_copy> find_all_copy_instr(const FlowGraphType& graph);
-
-        std::vector<ir::ir_copy> meet(const NodeType& node, const std::vector<ir::ir_copy>& all_copies);
-
-        static bool contains_instruction(const std::vector<ir::ir_copy>& copy_instructions,
-                                         const ir::ir_copy& instructions);
-
-        void annotate_instruction(int block_id, size_t instr_index, const std::vector<ir::ir_copy>& reaching_copies);
+        [[nodiscard]] std::string_view name() const override {
+            return "copy-propagation";
+        }
 
-        std::vector<ir::ir_copy> get_instruction_annotations(int block_id, size_t instr_index);
+        [[nodiscard]] Analysis required_analyses() const override {
+            return Analysis::Cfg;
+        }
 
-        void annotate_block(const NodeType& node, const std::vector<ir::ir_copy>& reaching_copies);
+        Changes apply(ir::ir_function& function, PassContext& context) override;
 
-        std::vector<ir::ir_copy> get_block_annotation(int node_id);
+    private:
+        //every distinct copy in the function, a copy is identified by its bit index
+        std::vector<ir::ir_instruction> copies;
+        //copies that read or write the value, killed when it is redefined
+        std::unordered_map<ir::ir_value, util::bit_vector> copies_touching;
+        std::unordered_map<ir::ir_value, std::vector<std::uint32_t> > copies_by_result;
+        //copies that read or write a global, killed by a call that can write it
+        util::bit_vector global_copies;
+        const SideEffects* side_effects = nullptr;
+        Dataflow<ir::ir_instruction> reaching_copies{DataflowDirection::Forward, DataflowMeet::Intersection};
 
-        void kill_copies(std::vector<ir::ir_copy>& reaching_copies, const ir::ir_value& value);
+        void find_reaching_copies(const FlowGraphType& graph);
 
-        void transfer(NodeType& node, std::vector<ir::ir_copy>& initial_reaching_copies);
+        void collect_copies(const FlowGraphType& graph);
 
-        ir::ir_value replace_operand(ir::ir_value& operand, std::vector<ir::ir_copy>& reaching_copies);
+        std::uint32_t copy_index(const ir::ir_instruction& copy) const;
 
-        std::optional<ir::ir_instruction> rewrite_instruction(ir::ir_copy& copy, std::vector<ir::ir_copy>& reaching_copies);
+        [[nodiscard]] bool writes_globals(const ir::ir_instruction& instruction) const;
 
-        std::optional<ir::ir_instruction> rewrite_instruction(ir::ir_unary& unary, std::vector<ir::ir_copy>& reaching_copies);
+        void transfer(const ir::ir_instruction& instruction, util::bit_vector& reaching) const;
 
-        std::optional<ir::ir_instruction> rewrite_instruction(ir::ir_binary& binary, std::vector<ir::ir_copy>& reaching_copies);
+        ir::ir_value replace_operand(const ir::ir_value& operand, const util::bit_vector& reaching) const;
 
-        std::optional<ir::ir_instruction> rewrite_instruction(ir::ir_call& binary, std::vector<ir::ir_copy>& reaching_copies);
+        std::optional<ir::ir_instruction> rewrite_instruction(const ir::ir_instruction& instruction, const util::bit_vector& reaching) const;
 
-        //default case for every instruction we don't handle
-        template <typename T, typename T2>
-        std::optional<ir::ir_instruction> rewrite_instruction(T& t, T2&) {
-            return t;
-        }
+        bool rewrite_arguments(const ir::ir_instruction& call, const util::bit_vector& reaching, ir::ir_operand_pool& operands) const;
     };
 }
@@ -0,0 +1,60 @@
+#include "dead_code_elimination.hpp"
+
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes DeadCodeElimination::apply(ir::ir_function& function, PassContext& context) {
+        auto& analyses = context.analyses;
+        Changes changes = Changes::None;
+
+        while (sweep(function.graph, analyses.liveness(), analyses.side_effects())) {
+            changes = Changes::Removed;
+            analyses.invalidate(changes);
+        }
+
+        return changes;
+    }
+
+    bool DeadCodeElimination::sweep(FlowGraphType& graph, const Liveness& liveness, const SideEffects& side_effects) {
+        bool removed = false;
+
+        for (auto& node : graph.nodes) {
+            if (node.removed || node.instructions.empty())
+                continue;
+
+            //walks the block bottom up, kept instructions are packed towards the end
+            auto live = liveness.live_out(node.id);
+            auto& instructions = node.instructions;
+            auto kept = instructions.size();
+
+            for (auto i = instructions.size(); i-- > 0;) {
+                const auto instruction = instructions[i];
+                if (is_removable(instruction, side_effects) && !liveness.is_live(instruction.result(), live)) {
+                    removed = true;
+                    continue;
+                }
+
+                liveness.step(instruction, live);
+                instructions[--kept] = instruction;
+            }
+
+            instructions.erase(instructions.begin(), instructions.begin() + static_cast<std::ptrdiff_t>(kept));
+        }
+
+        return removed;
+    }
+
+    bool DeadCodeElimination::is_removable(const ir::ir_instruction& instruction, const SideEffects& side_effects) {
+        switch (instruction.opcode) {
+        case ir::ir_opcode::Binary:
+        case ir::ir_opcode::Unary:
+        case ir::ir_opcode::Copy:
+        case ir::ir_opcode::Phi:
+            return true;
+        case ir::ir_opcode::Call:
+            return side_effects.is_pure(instruction.callee());
+        default:
+            return false;
+        }
+    }
+}
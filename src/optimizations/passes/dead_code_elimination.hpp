@@ -0,0 +1,31 @@
+#pragma once
+#include "flow_graph/flow_graph.hpp"
+#include "ir/ir.h"
+#include "optimizations/analysis/liveness.hpp"
+#include "optimizations/analysis/side_effects.hpp"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Deletes instructions whose result is dead. Only side effect free ones are candidates: binary, unary, copies, phis
+    //and calls to pure functions. Removing an instruction can make the values it read dead, so sweeps repeat with
+    //fresh liveness until one removes nothing
+    class DeadCodeElimination : public Pass {
+    public:
+        using FlowGraphType = FlowGraph<ir::ir_instruction>;
+
+        [[nodiscard]] std::string_view name() const override {
+            return "dead-code";
+        }
+
+        [[nodiscard]] Analysis required_analyses() const override {
+            return Analysis::Liveness;
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
+
+    private:
+        static bool sweep(FlowGraphType& graph, const Liveness& liveness, const SideEffects& side_effects);
+
+        static bool is_removable(const ir::ir_instruction& instruction, const SideEffects& side_effects);
+    };
+}
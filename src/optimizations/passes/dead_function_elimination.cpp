@@ -0,0 +1,42 @@
+#include "dead_function_elimination.hpp"
+
+#include <vector>
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes DeadFunctionElimination::apply(ir::ir_program& program, AnalysisManager& analyses) {
+        const auto& call_graph = analyses.call_graph();
+        std::vector<bool> reached(program.functions.size(), false);
+        std::vector<std::size_t> worklist;
+
+        for (std::size_t index = 0; index < program.functions.size(); ++index) {
+            if (!program.functions[index].internal) {
+                reached[index] = true;
+                worklist.push_back(index);
+            }
+        }
+
+        while (!worklist.empty()) {
+            const auto index = worklist.back();
+            worklist.pop_back();
+
+            for (const auto callee : call_graph.callees(index)) {
+                if (!reached[callee]) {
+                    reached[callee] = true;
+                    worklist.push_back(callee);
+                }
+            }
+        }
+
+        std::vector<ir::ir_function> functions;
+        functions.reserve(program.functions.size());
+        for (std::size_t index = 0; index < program.functions.size(); ++index) {
+            if (reached[index])
+                functions.push_back(std::move(program.functions[index]));
+        }
+
+        const bool removed = functions.size() != program.functions.size();
+        program.functions = std::move(functions);
+        return removed ? Changes::Removed : Changes::None;
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "ir/ir_function.h"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Removes the functions the optimizer made that no call reaches anymore, like a clone that was inlined
+    //everywhere. Functions from the source are kept, something outside the program may call them
+    class DeadFunctionElimination : public ProgramPass {
+    public:
+        [[nodiscard]] std::string_view name() const override {
+            return "dead-function-elimination";
+        }
+
+        Changes apply(ir::ir_program& program, AnalysisManager& analyses) override;
+    };
+}
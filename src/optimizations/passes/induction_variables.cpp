@@ -0,0 +1,321 @@
+#include "induction_variables.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes InductionVariables::apply(ir::ir_function& function, PassContext& context) {
+        auto& graph = function.graph;
+        const auto& operands = context.program.operands;
+        Changes changes = Changes::None;
+
+        //instructions change but the CFG does not, so the loops stay valid
+        for (const auto& loop : graph.loops().loops()) {
+            if (loop.latches.size() != 1 || loop.preheader == INVALID)
+                continue;
+
+            std::vector<ir::ir_instruction> phis;
+            std::ranges::copy_if(graph.get_node_from_id(loop.header).instructions, std::back_inserter(phis), [](const ir::ir_instruction& instruction) {
+                return instruction.opcode == ir::ir_opcode::Phi;
+            });
+
+            for (const auto& phi : phis) {
+                collect(graph, loop, operands);
+                if (const auto variable = match(phi, loop, operands))
+                    changes |= reduce(graph, loop, *variable, context.program, context.analyses.side_effects());
+            }
+        }
+
+        return changes;
+    }
+
+    void InductionVariables::collect(const FlowGraphType& graph, const Loop& loop, const ir::ir_operand_pool& operands) {
+        definitions.clear();
+        definition_counts.clear();
+        use_counts.clear();
+        defined_in_loop.clear();
+
+        for (const auto& node : graph.nodes) {
+            if (node.removed)
+                continue;
+
+            const bool in_loop = std::ranges::contains(loop.blocks, node.id);
+            for (const auto& instruction : node.instructions) {
+                for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot)
+                    ++use_counts[instruction.operand(slot)];
+
+                if (instruction.opcode == ir::ir_opcode::Call) {
+                    for (const auto& argument : operands.arguments(instruction))
+                        ++use_counts[argument];
+                }
+
+                if (instruction.opcode == ir::ir_opcode::Phi) {
+                    const auto incoming = operands.incoming(instruction);
+                    for (std::size_t i = 0; i < incoming.size(); i += 2)
+                        ++use_counts[incoming[i]];
+                }
+
+                if (!instruction.has_result())
+                    continue;
+
+                definitions[instruction.result()] = instruction;
+                ++definition_counts[instruction.result()];
+                if (in_loop)
+                    defined_in_loop.insert(instruction.result());
+            }
+        }
+    }
+
+    std::optional<InductionVariables::InductionVariable> InductionVariables::match(const ir::ir_instruction& phi, const Loop& loop,
+                                                                                  const ir::ir_operand_pool& operands) const {
+        const auto result = phi.result();
+        const auto incoming = operands.incoming(phi);
+        if (incoming.size() != 4 || definition_counts.at(result) != 1)
+            return {};
+
+        std::optional<ir::ir_value> init;
+        std::optional<ir::ir_value> back;
+        for (std::size_t i = 0; i < incoming.size(); i += 2) {
+            if (incoming[i + 1].get_constant() == loop.preheader)
+                init = incoming[i];
+            else if (incoming[i + 1].get_constant() == loop.latches.front())
+                back = incoming[i];
+        }
+
+        if (!init.has_value() || !back.has_value())
+            return {};
+
+        //the back edge value goes through copies to the increment
+        std::vector chain{*back};
+        while (true) {
+            const auto it = definitions.find(chain.back());
+            if (it == definitions.end() || !defined_in_loop.contains(chain.back()) || definition_counts.at(chain.back()) != 1)
+                return {};
+
+            const auto& definition = it->second;
+            if (definition.opcode != ir::ir_opcode::Copy)
+                break;
+
+            if (definition.source().is_constant() || definition.source() == result)
+                return {};
+            chain.push_back(definition.source());
+        }
+
+        const auto& increment = definitions.at(chain.back());
+        if (increment.opcode != ir::ir_opcode::Binary)
+            return {};
+
+        const auto left = increment.left();
+        const auto right = increment.right();
+        std::optional<int> step;
+        if (increment.op() == token_type::Plus && left == result && right.is_constant())
+            step = right.get_constant();
+        else if (increment.op() == token_type::Plus && right == result && left.is_constant())
+            step = left.get_constant();
+        else if (increment.op() == token_type::Minus && left == result && right.is_constant() && right.get_constant() != std::numeric_limits<int>::min())
+            step = -right.get_constant();
+
+        if (!step.has_value() || *step == 0)
+            return {};
+
+        return InductionVariable{result, *init, *step, std::move(chain)};
+    }
+
+    Changes InductionVariables::reduce(FlowGraphType& graph, const Loop& loop, const InductionVariable& variable, ir::ir_program& program,
+                                       const SideEffects& side_effects) {
+        const auto is_invariant = [&](const ir::ir_value& value) {
+            return value.is_constant() || (!defined_in_loop.contains(value) && !side_effects.is_global(value));
+        };
+
+        std::vector<Use> products;
+        std::vector<Use> comparisons;
+        for (const auto block : loop.blocks) {
+            for (const auto& instruction : graph.get_node_from_id(block).instructions) {
+                if (instruction.opcode != ir::ir_opcode::Binary || (instruction.left() == variable.phi) == (instruction.right() == variable.phi))
+                    continue;
+
+                const auto other = instruction.left() == variable.phi ? instruction.right() : instruction.left();
+                if (instruction.op() == token_type::Star && is_invariant(other))
+                    products.push_back({instruction.result(), other});
+                else if (instruction.op() == token_type::LessLess && instruction.left() == variable.phi && other.is_constant() && other.get_constant() >= 0 &&
+                         other.get_constant() < 31)
+                    products.push_back({instruction.result(), ir::ir_value{1 << other.get_constant()}});
+                else if (is_comparison(instruction.op()) && other.is_constant())
+                    comparisons.push_back({instruction.result(), other});
+            }
+        }
+
+        if (products.empty())
+            return Changes::None;
+
+        //one new variable per distinct factor
+        std::vector<std::pair<ir::ir_value, ir::ir_value> > reduced;
+        std::vector<ir::ir_instruction> preheader_code;
+        std::vector<ir::ir_instruction> header_code;
+        std::vector<ir::ir_instruction> latch_code;
+        for (const auto& product : products) {
+            if (std::ranges::contains(reduced, product.other, &std::pair<ir::ir_value, ir::ir_value>::first))
+                continue;
+
+            const auto current = fresh_value(program.symbols);
+            const auto next = fresh_value(program.symbols);
+            const auto start = multiply(variable.init, product.other, preheader_code, program.symbols);
+            const auto step = multiply(ir::ir_value{variable.step}, product.other, preheader_code, program.symbols);
+
+            const std::vector incoming{start, ir::ir_value{loop.preheader}, next, ir::ir_value{loop.latches.front()}};
+            header_code.push_back(ir::make_phi(current, program.operands.append(incoming), 2));
+            latch_code.push_back(ir::make_binary(token_type::Plus, current, step, next));
+            reduced.emplace_back(product.other, current);
+        }
+
+        const auto reduced_of = [&reduced](const ir::ir_value& factor) {
+            return std::ranges::find(reduced, factor, &std::pair<ir::ir_value, ir::ir_value>::first)->second;
+        };
+
+        //the exit tests move to a constant factor, the old variable is then only kept alive by its own increment
+        const auto factor = std::ranges::find_if(reduced, [](const auto& entry) {
+            return entry.first.is_constant() && entry.first.get_constant() != 0;
+        });
+        const bool replace_tests = factor != reduced.end() &&
+                                   can_replace_tests(graph, loop, variable, factor->first.get_constant(), products.size(), comparisons);
+
+        for (const auto block : loop.blocks) {
+            for (auto& instruction : graph.get_node_from_id(block).instructions) {
+                if (!instruction.has_result())
+                    continue;
+
+                const auto result = instruction.result();
+                if (const auto product = std::ranges::find(products, result, &Use::result); product != products.end()) {
+                    instruction = ir::make_copy(result, reduced_of(product->other));
+                    continue;
+                }
+
+                if (!replace_tests || !std::ranges::contains(comparisons, result, &Use::result))
+                    continue;
+
+                //i op n is r op n * k, the order flips with a negative factor
+                const auto k = factor->first.get_constant();
+                const bool variable_left = instruction.left() == variable.phi;
+                const auto bound = ir::ir_value{(variable_left ? instruction.right() : instruction.left()).get_constant() * k};
+                instruction.set_left(variable_left ? factor->second : bound);
+                instruction.set_right(variable_left ? bound : factor->second);
+                if (k < 0)
+                    instruction.attribute = static_cast<std::uint32_t>(mirror(instruction.op()));
+            }
+        }
+
+        Changes changes = Changes::Inserted | Changes::Rewritten;
+        if (replace_tests) {
+            for (const auto block : loop.blocks) {
+                std::erase_if(graph.get_node_from_id(block).instructions, [&variable](const ir::ir_instruction& instruction) {
+                    return instruction.has_result() && (instruction.result() == variable.phi || std::ranges::contains(variable.chain, instruction.result()));
+                });
+            }
+            changes |= Changes::Removed;
+        }
+
+        auto& header = graph.get_node_from_id(loop.header).instructions;
+        auto position = header.begin();
+        while (position != header.end() && (position->opcode == ir::ir_opcode::Label || position->opcode == ir::ir_opcode::Phi))
+            ++position;
+        header.insert(position, header_code.begin(), header_code.end());
+
+        insert_before_jump(graph.get_node_from_id(loop.preheader), preheader_code);
+        insert_before_jump(graph.get_node_from_id(loop.latches.front()), latch_code);
+        return changes;
+    }
+
+    //only with constant bounds, so it is known that neither the new variable nor the new bound overflows
+    bool InductionVariables::can_replace_tests(const FlowGraphType& graph, const Loop& loop, const InductionVariable& variable, const int k,
+                                               const std::size_t product_count, const std::vector<Use>& comparisons) const {
+        if (!variable.init.is_constant() || !exits_on_comparison(graph, loop, variable, comparisons))
+            return false;
+
+        const auto uses = use_counts.find(variable.phi);
+        if (uses == use_counts.end() || static_cast<std::size_t>(uses->second) != 1 + product_count + comparisons.size())
+            return false;
+
+        if (std::ranges::any_of(variable.chain, [this](const ir::ir_value& value) { return use_counts.at(value) != 1; }))
+            return false;
+
+        std::int64_t largest = std::llabs(variable.init.get_constant());
+        for (const auto& comparison : comparisons)
+            largest = std::max<std::int64_t>(largest, std::llabs(comparison.other.get_constant()));
+
+        return (largest + std::llabs(variable.step)) * std::llabs(k) <= std::numeric_limits<int>::max();
+    }
+
+    //i stays between init and the compared constants only when one of the comparisons ends the loop, with i moving
+    //towards its constant. The header tests it on every round, so i never gets further than one step past it
+    bool InductionVariables::exits_on_comparison(const FlowGraphType& graph, const Loop& loop, const InductionVariable& variable,
+                                                 const std::vector<Use>& comparisons) const {
+        const auto& header = graph.get_node_from_id(loop.header).instructions;
+        if (header.empty() || header.back().opcode != ir::ir_opcode::JumpIfZero || !std::ranges::contains(comparisons, header.back().source(), &Use::result)
+            || std::ranges::contains(loop.blocks, graph.label_to_block_id(header.back().label())))
+            return false;
+
+        //the loop runs while the test holds
+        const auto& compare = definitions.at(header.back().source());
+        const auto op = compare.left() == variable.phi ? compare.op() : mirror(compare.op());
+        if (variable.step > 0)
+            return op == token_type::Less || op == token_type::LessEqual;
+        return op == token_type::Greater || op == token_type::GreaterEqual;
+    }
+
+    ir::ir_value InductionVariables::multiply(const ir::ir_value& left, const ir::ir_value& right, std::vector<ir::ir_instruction>& preheader_code,
+                                              ir::symbol_table& symbols) {
+        if (left.is_constant() && right.is_constant()) {
+            const auto product = static_cast<std::int64_t>(left.get_constant()) * right.get_constant();
+            if (product >= std::numeric_limits<int>::min() && product <= std::numeric_limits<int>::max())
+                return ir::ir_value{static_cast<int>(product)};
+        }
+
+        const auto result = fresh_value(symbols);
+        preheader_code.push_back(ir::make_binary(token_type::Star, left, right, result));
+        return result;
+    }
+
+    ir::ir_value InductionVariables::fresh_value(ir::symbol_table& symbols) {
+        return ir::ir_value::variable(symbols.intern("iv." + std::to_string(counter++)));
+    }
+
+    bool InductionVariables::is_comparison(const token_type op) {
+        switch (op) {
+        case token_type::Less:
+        case token_type::LessEqual:
+        case token_type::Greater:
+        case token_type::GreaterEqual:
+        case token_type::EqualEqual:
+        case token_type::NotEqual:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    token_type InductionVariables::mirror(const token_type op) {
+        switch (op) {
+        case token_type::Less:
+            return token_type::Greater;
+        case token_type::LessEqual:
+            return token_type::GreaterEqual;
+        case token_type::Greater:
+            return token_type::Less;
+        case token_type::GreaterEqual:
+            return token_type::LessEqual;
+        default:
+            return op;
+        }
+    }
+
+    void InductionVariables::insert_before_jump(NodeType& node, const std::vector<ir::ir_instruction>& instructions) {
+        auto& code = node.instructions;
+        auto position = code.end();
+        if (!code.empty() && code.back().is_jump())
+            --position;
+        code.insert(position, instructions.begin(), instructions.end());
+    }
+}
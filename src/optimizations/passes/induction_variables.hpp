@@ -0,0 +1,81 @@
+#pragma once
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "flow_graph/flow_graph.hpp"
+#include "flow_graph/loop_info.hpp"
+#include "ir/ir.h"
+#include "ir/ir_function.h"
+#include "lexer/token.h"
+#include "optimizations/analysis/side_effects.hpp"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Strength reduction of induction variables, on SSA form. A basic induction variable is a header phi whose value
+    //on the back edge is the phi plus or minus a constant, through any number of copies. Every i * k in the loop with
+    //k invariant, and i << c as i * 2^c, becomes a new phi that starts at init * k and grows by step * k on the back
+    //edge. When the rest of the uses of i are comparisons against constants and the loop exits from the header on one
+    //of them, they are rewritten on the new variable and i is deleted
+    class InductionVariables : public Pass {
+    public:
+        using FlowGraphType = FlowGraph<ir::ir_instruction>;
+        using NodeType = Node<ir::ir_instruction>;
+
+        [[nodiscard]] std::string_view name() const override {
+            return "induction-variables";
+        }
+
+        [[nodiscard]] Analysis required_analyses() const override {
+            return Analysis::Loops;
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
+
+        //the operator that gives the same result with the operands swapped
+        static token_type mirror(token_type op);
+
+    private:
+        struct InductionVariable {
+            ir::ir_value phi;
+            ir::ir_value init;
+            int step;
+            //value on the back edge first, the increment last
+            std::vector<ir::ir_value> chain;
+        };
+
+        //i * k with k invariant, or a comparison of i against a constant
+        struct Use {
+            ir::ir_value result;
+            ir::ir_value other;
+        };
+
+        std::uint32_t counter = 0;
+        std::unordered_map<ir::ir_value, ir::ir_instruction> definitions;
+        std::unordered_map<ir::ir_value, int> definition_counts;
+        std::unordered_map<ir::ir_value, int> use_counts;
+        std::unordered_set<ir::ir_value> defined_in_loop;
+
+        void collect(const FlowGraphType& graph, const Loop& loop, const ir::ir_operand_pool& operands);
+
+        [[nodiscard]] std::optional<InductionVariable> match(const ir::ir_instruction& phi, const Loop& loop, const ir::ir_operand_pool& operands) const;
+
+        Changes reduce(FlowGraphType& graph, const Loop& loop, const InductionVariable& variable, ir::ir_program& program,
+                       const SideEffects& side_effects);
+
+        [[nodiscard]] bool can_replace_tests(const FlowGraphType& graph, const Loop& loop, const InductionVariable& variable, int k,
+                                             std::size_t product_count, const std::vector<Use>& comparisons) const;
+
+        [[nodiscard]] bool exits_on_comparison(const FlowGraphType& graph, const Loop& loop, const InductionVariable& variable,
+                                               const std::vector<Use>& comparisons) const;
+
+        ir::ir_value multiply(const ir::ir_value& left, const ir::ir_value& right, std::vector<ir::ir_instruction>& preheader_code,
+                              ir::symbol_table& symbols);
+
+        ir::ir_value fresh_value(ir::symbol_table& symbols);
+
+        static bool is_comparison(token_type op);
+
+        static void insert_before_jump(NodeType& node, const std::vector<ir::ir_instruction>& instructions);
+    };
+}
@@ -0,0 +1,164 @@
+#include "inliner.hpp"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes Inliner::apply(ir::ir_function& function, PassContext& context) {
+        auto& program = context.program;
+
+        //block ids change when the caller is rebuilt, phis would lose their predecessors
+        if (!inline_size(function).has_value())
+            return Changes::None;
+
+        const auto selected = select_calls(function, context);
+        if (std::ranges::none_of(selected, [](const auto& callee) { return callee.has_value(); }))
+            return Changes::None;
+
+        const auto instructions = function.graph.release_instructions();
+        std::vector<ir::ir_instruction> output;
+        output.reserve(instructions.size());
+
+        std::size_t call_index = 0;
+        for (const auto& instruction : instructions) {
+            if (instruction.opcode != ir::ir_opcode::Call || !selected[call_index++].has_value()) {
+                output.push_back(instruction);
+                continue;
+            }
+
+            const auto& callee = program.functions[*selected[call_index - 1]];
+            inline_call(instruction, callee, function, program, context.analyses.side_effects(), output);
+        }
+
+        function.graph.generate_flowgraph(std::move(output));
+        return Changes::Cfg | Changes::Inserted | Changes::Removed;
+    }
+
+    //one entry per call in layout order, the index of the callee when the call is inlined
+    std::vector<std::optional<std::size_t> > Inliner::select_calls(const ir::ir_function& function, PassContext& context) const {
+        const auto& program = context.program;
+        const auto& call_graph = context.analyses.call_graph();
+        const auto caller = static_cast<std::size_t>(&function - program.functions.data());
+
+        std::vector<std::optional<std::size_t> > selected;
+        int growth = 0;
+
+        for (const auto& node : function.graph.nodes) {
+            for (const auto& instruction : node.instructions) {
+                if (instruction.opcode != ir::ir_opcode::Call)
+                    continue;
+
+                auto& decision = selected.emplace_back();
+                const auto callee = call_graph.function_index(instruction.callee());
+                if (!callee.has_value() || call_graph.is_recursive(caller, *callee))
+                    continue;
+
+                const auto& callee_function = program.functions[*callee];
+                if (callee_function.parameters.size() != instruction.argument_count())
+                    continue;
+
+                const auto size = inline_size(callee_function);
+                if (!size.has_value() || growth + *size > options.growth_budget)
+                    continue;
+
+                const auto constants = std::ranges::count_if(program.operands.arguments(instruction), [](const ir::ir_value& argument) {
+                    return argument.is_constant();
+                });
+                const auto cost = *size - options.call_bonus - options.constant_argument_bonus * static_cast<int>(constants);
+                if (cost > options.threshold)
+                    continue;
+
+                decision = callee;
+                growth += *size;
+            }
+        }
+        return selected;
+    }
+
+    void Inliner::inline_call(const ir::ir_instruction& call, const ir::ir_function& callee, ir::ir_function& caller, ir::ir_program& program,
+                              const SideEffects& side_effects, std::vector<ir::ir_instruction>& output) {
+        const auto suffix = ".i" + std::to_string(instances++);
+        std::unordered_map<ir::ir_value, ir::ir_value> renamed;
+
+        //globals keep their name, everything else local to the callee gets a fresh one in the caller
+        const auto rename = [&](const ir::ir_value& value) {
+            if (!value.is_temporary() && (!value.is_variable() || side_effects.is_global(value)))
+                return value;
+
+            const auto [it, inserted] = renamed.try_emplace(value);
+            if (inserted) {
+                it->second = value.is_temporary()
+                                 ? program.make_temporary()
+                                 : ir::ir_value::variable(program.symbols.intern(program.symbols.name(value.get_index()) + suffix));
+            }
+            return it->second;
+        };
+
+        std::vector<std::uint32_t> labels;
+        labels.reserve(callee.label_count());
+        for (const auto kind : callee.labels)
+            labels.push_back(caller.create_label(kind));
+        const auto end = caller.create_label(ir::ir_label_kind::InlineEnd);
+
+        //the pool can grow while cloning calls, the arguments are copied out first
+        const auto arguments = program.operands.arguments(call);
+        const std::vector<ir::ir_value> argument_values(arguments.begin(), arguments.end());
+        for (std::size_t i = 0; i < argument_values.size(); ++i)
+            output.push_back(ir::make_copy(rename(callee.parameters[i]), argument_values[i]));
+
+        for (const auto& node : callee.graph.nodes) {
+            for (auto instruction : node.instructions) {
+                switch (instruction.opcode) {
+                case ir::ir_opcode::Return:
+                    output.push_back(ir::make_copy(call.result(), rename(instruction.source())));
+                    output.push_back(ir::make_jump(end));
+                    continue;
+                case ir::ir_opcode::Call: {
+                    std::vector<ir::ir_value> call_arguments;
+                    for (const auto& argument : program.operands.arguments(instruction))
+                        call_arguments.push_back(rename(argument));
+
+                    const auto offset = program.operands.append(call_arguments);
+                    output.push_back(ir::make_call(instruction.callee(), offset, instruction.argument_count(), rename(instruction.result())));
+                    continue;
+                }
+                case ir::ir_opcode::Label:
+                case ir::ir_opcode::Jump:
+                case ir::ir_opcode::JumpIfZero:
+                case ir::ir_opcode::JumpIfNotZero:
+                    instruction.attribute = labels[instruction.label()];
+                    break;
+                default:
+                    break;
+                }
+
+                for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot)
+                    instruction.set_operand(slot, rename(instruction.operand(slot)));
+
+                if (instruction.has_result())
+                    instruction.set_result(rename(instruction.result()));
+
+                output.push_back(instruction);
+            }
+        }
+
+        //a callee falling off its end reaches here too, leaving the result unset as the call did
+        output.push_back(ir::make_label(end));
+    }
+
+    std::optional<int> Inliner::inline_size(const ir::ir_function& callee) {
+        int size = 0;
+        for (const auto& node : callee.graph.nodes) {
+            for (const auto& instruction : node.instructions) {
+                if (instruction.opcode == ir::ir_opcode::Phi)
+                    return {};
+
+                if (instruction.opcode != ir::ir_opcode::Label)
+                    ++size;
+            }
+        }
+        return size;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <vector>
+#include "ir/ir.h"
+#include "ir/ir_function.h"
+#include "optimizations/analysis/side_effects.hpp"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Replaces calls by a copy of the callee body. Arguments are copied into renamed parameters, every return becomes
+    //a copy into the call result and a jump past the inlined code. Runs before SSA construction, the caller is
+    //rebuilt from its flattened instructions. Callees are optimized first, so their final size decides: the callee
+    //size minus the bonuses has to stay under the threshold and the caller may only grow by the budget
+    class Inliner : public Pass {
+    public:
+        struct Options {
+            //largest cost that is still inlined, in instructions
+            int threshold = 24;
+            //instructions saved by dropping the call itself
+            int call_bonus = 4;
+            //per constant argument, the code reading the parameter is likely to fold away once inlined
+            int constant_argument_bonus = 4;
+            //instructions a caller may grow by in total
+            int growth_budget = 200;
+        };
+
+        Inliner() = default;
+
+        explicit Inliner(const Options options)
+            : options(options) {}
+
+        [[nodiscard]] std::string_view name() const override {
+            return "inliner";
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
+
+    private:
+        Options options;
+        //numbers every inlined copy, keeps the renamed variables of different copies apart
+        std::size_t instances = 0;
+
+        std::vector<std::optional<std::size_t> > select_calls(const ir::ir_function& function, PassContext& context) const;
+
+        void inline_call(const ir::ir_instruction& call, const ir::ir_function& callee, ir::ir_function& caller, ir::ir_program& program,
+                         const SideEffects& side_effects, std::vector<ir::ir_instruction>& output);
+
+        //instructions the callee adds to a caller, nullopt when it can not be copied
+        static std::optional<int> inline_size(const ir::ir_function& callee);
+    };
+}
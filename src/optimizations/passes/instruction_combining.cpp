@@ -0,0 +1,270 @@
+#include "instruction_combining.hpp"
+
+#include <bit>
+#include <limits>
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes InstructionCombining::apply(ir::ir_function& function, PassContext& context) {
+        auto& graph = function.graph;
+        collect(graph, context.analyses.side_effects());
+        Changes changes = Changes::None;
+
+        for (auto& node : graph.nodes) {
+            if (node.removed)
+                continue;
+
+            auto& instructions = node.instructions;
+            for (std::size_t i = 0; i < instructions.size(); ++i) {
+                if (instructions[i].opcode != ir::ir_opcode::Binary && instructions[i].opcode != ir::ir_opcode::Unary)
+                    continue;
+
+                std::vector<ir::ir_instruction> code;
+                for (const auto& rule : rules()) {
+                    if (const auto matched = match(rule, instructions[i])) {
+                        rule.rewrite(*matched, code, context.program);
+                        break;
+                    }
+                }
+
+                if (code.empty())
+                    continue;
+
+                changes |= Changes::Rewritten;
+                if (code.size() > 1)
+                    changes |= Changes::Inserted;
+
+                //the old definition stays valid for later patterns, the new code computes the same value
+                instructions[i] = code.back();
+                instructions.insert(instructions.begin() + static_cast<std::ptrdiff_t>(i), code.begin(), code.end() - 1);
+                i += code.size() - 1;
+            }
+        }
+
+        return changes;
+    }
+
+    const std::vector<InstructionCombining::Rule>& InstructionCombining::rules() {
+        using enum Pattern;
+        using ir::ir_opcode;
+        static const std::vector<Rule> table{
+            {ir_opcode::Binary, token_type::Plus, Offset, Constant, add_to_offset},
+            {ir_opcode::Binary, token_type::Plus, Constant, Offset, add_to_offset},
+            {ir_opcode::Binary, token_type::Plus, Any, Zero, keep},
+            {ir_opcode::Binary, token_type::Plus, Zero, Any, keep},
+            {ir_opcode::Binary, token_type::Plus, Any, Negative, add_negative},
+            {ir_opcode::Binary, token_type::Plus, Negative, Any, add_negative},
+
+            {ir_opcode::Binary, token_type::Minus, Offset, Constant, subtract_from_offset},
+            {ir_opcode::Binary, token_type::Minus, Any, Zero, keep},
+            {ir_opcode::Binary, token_type::Minus, Any, Same, zero},
+            {ir_opcode::Binary, token_type::Minus, Zero, Any, negate},
+            {ir_opcode::Binary, token_type::Minus, Any, Negative, subtract_negative},
+
+            {ir_opcode::Binary, token_type::Star, Any, Zero, zero},
+            {ir_opcode::Binary, token_type::Star, Zero, Any, zero},
+            {ir_opcode::Binary, token_type::Star, Any, One, keep},
+            {ir_opcode::Binary, token_type::Star, One, Any, keep},
+            {ir_opcode::Binary, token_type::Star, Any, MinusOne, negate},
+            {ir_opcode::Binary, token_type::Star, MinusOne, Any, negate},
+            {ir_opcode::Binary, token_type::Star, Scaled, Constant, multiply_scaled},
+            {ir_opcode::Binary, token_type::Star, Constant, Scaled, multiply_scaled},
+            {ir_opcode::Binary, token_type::Star, Any, PowerOfTwo, shift_left},
+            {ir_opcode::Binary, token_type::Star, PowerOfTwo, Any, shift_left},
+
+            {ir_opcode::Binary, token_type::Slash, Any, One, keep},
+            {ir_opcode::Binary, token_type::Slash, Any, MinusOne, negate},
+            {ir_opcode::Binary, token_type::Slash, Any, PowerOfTwo, shift_divide},
+
+            {ir_opcode::Binary, token_type::LessLess, Any, Zero, keep},
+            {ir_opcode::Binary, token_type::GreaterGreater, Any, Zero, keep},
+
+            {ir_opcode::Binary, token_type::EqualEqual, Any, Same, one},
+            {ir_opcode::Binary, token_type::LessEqual, Any, Same, one},
+            {ir_opcode::Binary, token_type::GreaterEqual, Any, Same, one},
+            {ir_opcode::Binary, token_type::NotEqual, Any, Same, zero},
+            {ir_opcode::Binary, token_type::Less, Any, Same, zero},
+            {ir_opcode::Binary, token_type::Greater, Any, Same, zero},
+
+            {ir_opcode::Unary, token_type::Minus, Negated, Any, keep},
+            {ir_opcode::Unary, token_type::Tilde, Negated, Any, keep},
+        };
+        return table;
+    }
+
+    void InstructionCombining::collect(const FlowGraphType& graph, const SideEffects& side_effects) {
+        definitions.clear();
+        std::unordered_map<ir::ir_value, int> definition_counts;
+
+        for (const auto& node : graph.nodes) {
+            if (node.removed)
+                continue;
+
+            for (const auto& instruction : node.instructions) {
+                if (!instruction.has_result() || side_effects.is_global(instruction.result()))
+                    continue;
+
+                if (++definition_counts[instruction.result()] == 1)
+                    definitions.emplace(instruction.result(), instruction);
+                else
+                    definitions.erase(instruction.result());
+            }
+        }
+
+        //the value inside a pattern has to be the same at the definition and at the use
+        std::erase_if(definitions, [&](const auto& entry) {
+            const auto& instruction = entry.second;
+            for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot) {
+                const auto operand = instruction.operand(slot);
+                if (side_effects.is_global(operand) || definition_counts[operand] > 1)
+                    return true;
+            }
+            return false;
+        });
+    }
+
+    std::optional<InstructionCombining::Match> InstructionCombining::match(const Rule& rule, const ir::ir_instruction& instruction) const {
+        if (instruction.opcode != rule.opcode || instruction.op() != rule.op)
+            return std::nullopt;
+
+        Match matched{.result = instruction.result()};
+        if (!match_operand(rule.left, rule.op, instruction.left(), instruction.left(), matched))
+            return std::nullopt;
+
+        if (rule.opcode == ir::ir_opcode::Binary && !match_operand(rule.right, rule.op, instruction.right(), instruction.left(), matched))
+            return std::nullopt;
+
+        return matched;
+    }
+
+    bool InstructionCombining::match_operand(const Pattern pattern, const token_type op, const ir::ir_value& operand, const ir::ir_value& left,
+                                             Match& match) const {
+        const auto constant = operand.is_constant() ? std::optional{operand.get_constant()} : std::nullopt;
+        switch (pattern) {
+        case Pattern::Any:
+            match.value = operand;
+            return true;
+        case Pattern::Same:
+            return operand == left;
+        case Pattern::Zero:
+            return constant == 0;
+        case Pattern::One:
+            return constant == 1;
+        case Pattern::MinusOne:
+            return constant == -1;
+        case Pattern::Negative:
+            match.constant = constant.value_or(0);
+            return constant.has_value() && *constant < 0 && *constant != std::numeric_limits<int>::min();
+        case Pattern::PowerOfTwo:
+            match.constant = constant.value_or(0);
+            return constant.has_value() && *constant > 1 && std::has_single_bit(static_cast<unsigned>(*constant));
+        case Pattern::Constant:
+            match.constant = constant.value_or(0);
+            return constant.has_value();
+        default:
+            break;
+        }
+
+        const auto definition = definitions.find(operand);
+        if (definition == definitions.end())
+            return false;
+
+        const auto& instruction = definition->second;
+        if (pattern == Pattern::Negated) {
+            match.value = instruction.left();
+            return instruction.opcode == ir::ir_opcode::Unary && instruction.op() == op;
+        }
+
+        if (instruction.opcode != ir::ir_opcode::Binary || instruction.left().is_constant() == instruction.right().is_constant())
+            return false;
+
+        const bool constant_right = instruction.right().is_constant();
+        const auto inner = constant_right ? instruction.right().get_constant() : instruction.left().get_constant();
+        match.value = constant_right ? instruction.left() : instruction.right();
+
+        if (pattern == Pattern::Offset) {
+            match.inner = instruction.op() == token_type::Minus ? wrap(-static_cast<std::int64_t>(inner)) : inner;
+            return instruction.op() == token_type::Plus || (instruction.op() == token_type::Minus && constant_right);
+        }
+
+        if (instruction.op() == token_type::LessLess) {
+            match.inner = constant_right && inner >= 0 && inner < 31 ? 1 << inner : 0;
+            return match.inner != 0;
+        }
+
+        match.inner = inner;
+        return instruction.op() == token_type::Star;
+    }
+
+    int InstructionCombining::wrap(const std::int64_t value) {
+        return static_cast<int>(static_cast<std::uint32_t>(value));
+    }
+
+    ir::ir_instruction InstructionCombining::offset(const ir::ir_value& result, const ir::ir_value& value, const int amount) {
+        if (amount == 0)
+            return ir::make_copy(result, value);
+
+        if (amount < 0 && amount != std::numeric_limits<int>::min())
+            return ir::make_binary(token_type::Minus, value, ir::ir_value{-amount}, result);
+
+        return ir::make_binary(token_type::Plus, value, ir::ir_value{amount}, result);
+    }
+
+    void InstructionCombining::keep(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program&) {
+        code.push_back(ir::make_copy(match.result, match.value));
+    }
+
+    void InstructionCombining::zero(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program&) {
+        code.push_back(ir::make_copy(match.result, ir::ir_value{0}));
+    }
+
+    void InstructionCombining::one(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program&) {
+        code.push_back(ir::make_copy(match.result, ir::ir_value{1}));
+    }
+
+    void InstructionCombining::negate(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program&) {
+        code.push_back(ir::make_unary(token_type::Minus, match.value, match.result));
+    }
+
+    void InstructionCombining::add_to_offset(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program&) {
+        code.push_back(offset(match.result, match.value, wrap(static_cast<std::int64_t>(match.inner) + match.constant)));
+    }
+
+    void InstructionCombining::subtract_from_offset(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program&) {
+        code.push_back(offset(match.result, match.value, wrap(static_cast<std::int64_t>(match.inner) - match.constant)));
+    }
+
+    void InstructionCombining::add_negative(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program&) {
+        code.push_back(ir::make_binary(token_type::Minus, match.value, ir::ir_value{-match.constant}, match.result));
+    }
+
+    void InstructionCombining::subtract_negative(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program&) {
+        code.push_back(ir::make_binary(token_type::Plus, match.value, ir::ir_value{-match.constant}, match.result));
+    }
+
+    void InstructionCombining::multiply_scaled(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program&) {
+        const auto factor = wrap(static_cast<std::int64_t>(match.inner) * match.constant);
+        code.push_back(ir::make_binary(token_type::Star, match.value, ir::ir_value{factor}, match.result));
+    }
+
+    void InstructionCombining::shift_left(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program&) {
+        const auto shift = std::countr_zero(static_cast<unsigned>(match.constant));
+        code.push_back(ir::make_binary(token_type::LessLess, match.value, ir::ir_value{shift}, match.result));
+    }
+
+    //a shift alone rounds towards minus infinity, a negative value first gets 2^k - 1 added so the quotient rounds
+    //towards zero. The bias is sign - (sign << k) with sign = x >> 31, which is 0 or -1
+    void InstructionCombining::shift_divide(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program) {
+        const auto shift = ir::ir_value{std::countr_zero(static_cast<unsigned>(match.constant))};
+        const auto sign = program.make_temporary();
+        const auto scaled_sign = program.make_temporary();
+        const auto bias = program.make_temporary();
+        const auto biased = program.make_temporary();
+
+        code.push_back(ir::make_binary(token_type::GreaterGreater, match.value, ir::ir_value{31}, sign));
+        code.push_back(ir::make_binary(token_type::LessLess, sign, shift, scaled_sign));
+        code.push_back(ir::make_binary(token_type::Minus, sign, scaled_sign, bias));
+        code.push_back(ir::make_binary(token_type::Plus, match.value, bias, biased));
+        code.push_back(ir::make_binary(token_type::GreaterGreater, biased, shift, match.result));
+    }
+}
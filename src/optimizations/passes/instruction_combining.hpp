@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "flow_graph/flow_graph.hpp"
+#include "ir/ir.h"
+#include "ir/ir_function.h"
+#include "lexer/token.h"
+#include "optimizations/analysis/side_effects.hpp"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Algebraic simplification of instructions that are not all constant, on SSA form. Each rule names an operator
+    //and a pattern per operand, the first rule that matches rewrites the instruction: identities like x + 0 or x - x,
+    //double negation, chains of constants like (x + 1) + 2 and multiplication or division by a power of two as
+    //shifts. Patterns look through an operand to its definition when it is defined once and is not a global
+    class InstructionCombining : public Pass {
+    public:
+        using FlowGraphType = FlowGraph<ir::ir_instruction>;
+
+        [[nodiscard]] std::string_view name() const override {
+            return "instruction-combining";
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
+
+    private:
+        enum class Pattern : std::uint8_t {
+            Any,
+            //the same value as the left operand
+            Same,
+            Zero,
+            One,
+            MinusOne,
+            //below zero, without the minimum which has no negation
+            Negative,
+            //a power of two above one
+            PowerOfTwo,
+            Constant,
+            //defined as a value plus or minus a constant
+            Offset,
+            //defined as a value times a constant, or shifted left by a constant
+            Scaled,
+            //defined by the same unary operator
+            Negated,
+        };
+
+        //the value bound by Any, or the value inside Offset, Scaled and Negated
+        struct Match {
+            ir::ir_value result;
+            ir::ir_value value;
+            int constant = 0;
+            //the constant added by Offset or multiplied by Scaled
+            int inner = 0;
+        };
+
+        //the instructions that replace the matched one, the last one defines its result
+        using Rewrite = void (*)(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program);
+
+        //the right pattern is ignored for unary operators
+        struct Rule {
+            ir::ir_opcode opcode;
+            token_type op;
+            Pattern left;
+            Pattern right;
+            Rewrite rewrite;
+        };
+
+        std::unordered_map<ir::ir_value, ir::ir_instruction> definitions;
+
+        static const std::vector<Rule>& rules();
+
+        void collect(const FlowGraphType& graph, const SideEffects& side_effects);
+
+        [[nodiscard]] std::optional<Match> match(const Rule& rule, const ir::ir_instruction& instruction) const;
+
+        [[nodiscard]] bool match_operand(Pattern pattern, token_type op, const ir::ir_value& operand, const ir::ir_value& left, Match& match) const;
+
+        static int wrap(std::int64_t value);
+
+        //value + amount, written as a subtraction when the amount is negative
+        static ir::ir_instruction offset(const ir::ir_value& result, const ir::ir_value& value, int amount);
+
+        static void keep(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program);
+
+        static void zero(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program);
+
+        static void one(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program);
+
+        static void negate(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program);
+
+        static void add_to_offset(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program);
+
+        static void subtract_from_offset(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program);
+
+        static void add_negative(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program);
+
+        static void subtract_negative(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program);
+
+        static void multiply_scaled(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program);
+
+        static void shift_left(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program);
+
+        static void shift_divide(const Match& match, std::vector<ir::ir_instruction>& code, ir::ir_program& program);
+    };
+}
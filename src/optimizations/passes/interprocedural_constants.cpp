@@ -0,0 +1,255 @@
+#include "interprocedural_constants.hpp"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes InterproceduralConstants::apply(ir::ir_program& program, AnalysisManager& analyses) {
+        const auto& call_graph = analyses.call_graph();
+        const auto calls = collect_calls(program, call_graph);
+
+        std::vector<Constants> uniform(program.functions.size());
+        std::vector<std::vector<Specialization> > specializations(program.functions.size());
+        for (std::size_t index = 0; index < program.functions.size(); ++index) {
+            const auto& function = program.functions[index];
+            const bool arguments_match = std::ranges::all_of(calls[index], [&](const CallSite& call) {
+                return call_at(program, call).argument_count() == function.parameters.size();
+            });
+
+            //top level code shares the name of a function, main is called from outside
+            const auto name = program.symbols.name(function.name);
+            if (calls[index].empty() || !arguments_match || name == "entry" || name == "main")
+                continue;
+
+            uniform[index] = uniform_constants(index, calls[index], program);
+            specializations[index] = select_specializations(index, calls[index], uniform[index], program, call_graph);
+        }
+
+        //calls are redirected before anything is cloned, so a clone calls the same functions as its original
+        for (std::size_t index = 0; index < program.functions.size(); ++index) {
+            for (auto& specialization : specializations[index]) {
+                const auto name = program.symbols.name(program.functions[index].name);
+                specialization.name = program.symbols.intern(name + ".s" + std::to_string(clones++));
+
+                for (const auto& call : specialization.calls)
+                    program.functions[call.caller].graph.get_node_from_id(call.block).instructions[call.position].attribute = specialization.name;
+            }
+        }
+
+        Changes changes = Changes::None;
+        std::vector<ir::ir_function> functions;
+        functions.reserve(program.functions.size());
+        for (std::size_t index = 0; index < program.functions.size(); ++index) {
+            auto& function = program.functions[index];
+            std::vector<ir::ir_function> function_clones;
+            for (const auto& specialization : specializations[index]) {
+                auto& clone = function_clones.emplace_back(function);
+                clone.name = specialization.name;
+                clone.internal = true;
+                copy_operands(clone, program.operands);
+
+                auto constants = uniform[index];
+                constants.insert(constants.end(), specialization.constants.begin(), specialization.constants.end());
+                std::ranges::sort(constants);
+                bind_constants(clone, constants);
+                changes |= Changes::Cfg | Changes::Inserted;
+            }
+
+            if (!uniform[index].empty()) {
+                bind_constants(function, uniform[index]);
+                changes |= Changes::Cfg | Changes::Inserted;
+            }
+
+            functions.push_back(std::move(function));
+            std::ranges::move(function_clones, std::back_inserter(functions));
+        }
+
+        program.functions = std::move(functions);
+        return changes;
+    }
+
+    //per function, the calls to it from anywhere in the program
+    std::vector<std::vector<InterproceduralConstants::CallSite> > InterproceduralConstants::collect_calls(const ir::ir_program& program,
+                                                                                                          const CallGraph& call_graph) {
+        std::vector<std::vector<CallSite> > calls(program.functions.size());
+        for (std::size_t caller = 0; caller < program.functions.size(); ++caller) {
+            for (const auto& node : program.functions[caller].graph.nodes) {
+                if (node.removed)
+                    continue;
+
+                for (std::size_t position = 0; position < node.instructions.size(); ++position) {
+                    const auto& instruction = node.instructions[position];
+                    if (instruction.opcode != ir::ir_opcode::Call)
+                        continue;
+
+                    if (const auto callee = call_graph.function_index(instruction.callee()))
+                        calls[*callee].push_back({caller, node.id, position});
+                }
+            }
+        }
+        return calls;
+    }
+
+    //a recursive call passing the parameter on unchanged agrees with any constant
+    InterproceduralConstants::Constants InterproceduralConstants::uniform_constants(const std::size_t index, const std::vector<CallSite>& calls,
+                                                                                   const ir::ir_program& program) {
+        const auto& function = program.functions[index];
+        Constants constants;
+
+        for (std::size_t parameter = 0; parameter < function.parameters.size(); ++parameter) {
+            const auto& value = function.parameters[parameter];
+            std::optional<int> constant;
+            bool agrees = true;
+
+            for (const auto& call : calls) {
+                const auto argument = program.operands.arguments(call_at(program, call))[parameter];
+                if (argument.is_constant() && (!constant.has_value() || *constant == argument.get_constant()))
+                    constant = argument.get_constant();
+                else if (call.caller != index || argument != value || is_assigned(function, value))
+                    agrees = false;
+
+                if (!agrees)
+                    break;
+            }
+
+            if (agrees && constant.has_value())
+                constants.emplace_back(parameter, *constant);
+        }
+        return constants;
+    }
+
+    std::vector<InterproceduralConstants::Specialization> InterproceduralConstants::select_specializations(
+        const std::size_t index, const std::vector<CallSite>& calls, const Constants& uniform, const ir::ir_program& program,
+        const CallGraph& call_graph) const {
+        const auto& function = program.functions[index];
+        const auto branches = branch_parameters(function);
+        if (branches == 0 || size(function) > options.max_size)
+            return {};
+
+        std::vector<Specialization> specializations;
+        for (const auto& call : calls) {
+            if (call_graph.is_recursive(call.caller, index))
+                continue;
+
+            const auto arguments = program.operands.arguments(call_at(program, call));
+            Constants constants;
+            for (std::size_t parameter = 0; parameter < arguments.size() && parameter < 64; ++parameter) {
+                if ((branches >> parameter & 1) != 0 && arguments[parameter].is_constant() &&
+                    !std::ranges::contains(uniform, parameter, &std::pair<std::size_t, int>::first))
+                    constants.emplace_back(parameter, arguments[parameter].get_constant());
+            }
+
+            if (constants.empty())
+                continue;
+
+            auto existing = std::ranges::find(specializations, constants, &Specialization::constants);
+            if (existing == specializations.end()) {
+                specializations.push_back({constants, {}});
+                existing = specializations.end() - 1;
+            }
+            existing->calls.push_back(call);
+        }
+
+        std::ranges::stable_sort(specializations, std::ranges::greater{}, [](const Specialization& specialization) {
+            return specialization.calls.size();
+        });
+        if (specializations.size() > static_cast<std::size_t>(options.max_clones))
+            specializations.resize(static_cast<std::size_t>(options.max_clones));
+        return specializations;
+    }
+
+    std::uint64_t InterproceduralConstants::branch_parameters(const ir::ir_function& function) {
+        std::unordered_map<ir::ir_value, std::uint64_t> depends_on;
+        for (std::size_t parameter = 0; parameter < function.parameters.size() && parameter < 64; ++parameter)
+            depends_on[function.parameters[parameter]] |= std::uint64_t{1} << parameter;
+
+        //values flow through copies and arithmetic, around loops too, so this repeats until nothing is added
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (const auto& node : function.graph.nodes) {
+                for (const auto& instruction : node.instructions) {
+                    if (instruction.opcode != ir::ir_opcode::Copy && instruction.opcode != ir::ir_opcode::Binary &&
+                        instruction.opcode != ir::ir_opcode::Unary)
+                        continue;
+
+                    std::uint64_t sources = 0;
+                    for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot) {
+                        if (const auto found = depends_on.find(instruction.operand(slot)); found != depends_on.end())
+                            sources |= found->second;
+                    }
+
+                    auto& result = depends_on[instruction.result()];
+                    changed |= (result | sources) != result;
+                    result |= sources;
+                }
+            }
+        }
+
+        std::uint64_t branches = 0;
+        for (const auto& node : function.graph.nodes) {
+            for (const auto& instruction : node.instructions) {
+                if (instruction.opcode != ir::ir_opcode::JumpIfZero && instruction.opcode != ir::ir_opcode::JumpIfNotZero)
+                    continue;
+
+                if (const auto found = depends_on.find(instruction.source()); found != depends_on.end())
+                    branches |= found->second;
+            }
+        }
+        return branches;
+    }
+
+    bool InterproceduralConstants::is_assigned(const ir::ir_function& function, const ir::ir_value& value) {
+        return std::ranges::any_of(function.graph.nodes, [&value](const auto& node) {
+            return std::ranges::any_of(node.instructions, [&value](const ir::ir_instruction& instruction) {
+                return instruction.has_result() && instruction.result() == value;
+            });
+        });
+    }
+
+    int InterproceduralConstants::size(const ir::ir_function& function) {
+        int size = 0;
+        for (const auto& node : function.graph.nodes) {
+            size += static_cast<int>(std::ranges::count_if(node.instructions, [](const ir::ir_instruction& instruction) {
+                return instruction.opcode != ir::ir_opcode::Label;
+            }));
+        }
+        return size;
+    }
+
+    const ir::ir_instruction& InterproceduralConstants::call_at(const ir::ir_program& program, const CallSite& call) {
+        return program.functions[call.caller].graph.get_node_from_id(call.block).instructions[call.position];
+    }
+
+    void InterproceduralConstants::copy_operands(ir::ir_function& clone, ir::ir_operand_pool& operands) {
+        for (auto& node : clone.graph.nodes) {
+            for (auto& instruction : node.instructions) {
+                //the pool can grow while appending, the operands are copied out first
+                if (instruction.opcode == ir::ir_opcode::Call) {
+                    const auto arguments = operands.arguments(instruction);
+                    const std::vector<ir::ir_value> values(arguments.begin(), arguments.end());
+                    instruction = ir::make_call(instruction.callee(), operands.append(values), instruction.argument_count(), instruction.result());
+                } else if (instruction.opcode == ir::ir_opcode::Phi) {
+                    const auto incoming = operands.incoming(instruction);
+                    const std::vector<ir::ir_value> values(incoming.begin(), incoming.end());
+                    instruction = ir::make_phi(instruction.result(), operands.append(values), instruction.argument_count());
+                }
+            }
+        }
+    }
+
+    void InterproceduralConstants::bind_constants(ir::ir_function& function, const Constants& constants) {
+        std::vector<ir::ir_instruction> copies;
+        for (const auto& [parameter, constant] : constants)
+            copies.push_back(ir::make_copy(function.parameters[parameter], ir::ir_value{constant}));
+
+        auto& graph = function.graph;
+        const auto first = graph.get_node_from_id(ENTRY).successors.front();
+        const auto start = graph.add_node(std::move(copies), first);
+        graph.remove_edge(ENTRY, first);
+        graph.add_edge(ENTRY, start);
+        graph.add_edge(start, first);
+    }
+}
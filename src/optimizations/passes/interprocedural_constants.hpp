@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+#include "ir/ir.h"
+#include "ir/ir_function.h"
+#include "optimizations/analysis/call_graph.hpp"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Moves constant arguments into the functions they are passed to. A parameter that gets the same constant at every
+    //call is bound to it at the start of the function. For the parameters its branches depend on, a function gets a
+    //clone per combination of constants the calls pass, and those calls are redirected to the clone. Calls keep their
+    //arguments, only the callee changes. Runs on the unoptimized program, the scalar passes fold the rest later
+    class InterproceduralConstants : public ProgramPass {
+    public:
+        struct Options {
+            //largest function that is cloned, in instructions
+            int max_size = 80;
+            //clones per function, the combinations passed by the most calls are picked first
+            int max_clones = 4;
+        };
+
+        InterproceduralConstants() = default;
+
+        explicit InterproceduralConstants(const Options options)
+            : options(options) {}
+
+        [[nodiscard]] std::string_view name() const override {
+            return "interprocedural-constants";
+        }
+
+        Changes apply(ir::ir_program& program, AnalysisManager& analyses) override;
+
+    private:
+        struct CallSite {
+            std::size_t caller;
+            int block;
+            std::size_t position;
+        };
+
+        //parameter index and its value, ordered by parameter
+        using Constants = std::vector<std::pair<std::size_t, int> >;
+
+        struct Specialization {
+            Constants constants;
+            std::vector<CallSite> calls;
+            std::uint32_t name = 0;
+        };
+
+        Options options;
+        //numbers the clones, keeps their names apart
+        std::size_t clones = 0;
+
+        static std::vector<std::vector<CallSite> > collect_calls(const ir::ir_program& program, const CallGraph& call_graph);
+
+        [[nodiscard]] static Constants uniform_constants(std::size_t index, const std::vector<CallSite>& calls, const ir::ir_program& program);
+
+        [[nodiscard]] std::vector<Specialization> select_specializations(std::size_t index, const std::vector<CallSite>& calls, const Constants& uniform,
+                                                                         const ir::ir_program& program, const CallGraph& call_graph) const;
+
+        //bit i is set when a conditional jump depends on parameter i
+        [[nodiscard]] static std::uint64_t branch_parameters(const ir::ir_function& function);
+
+        [[nodiscard]] static bool is_assigned(const ir::ir_function& function, const ir::ir_value& value);
+
+        [[nodiscard]] static int size(const ir::ir_function& function);
+
+        static const ir::ir_instruction& call_at(const ir::ir_program& program, const CallSite& call);
+
+        //calls and phis keep their operands in the pool, a clone gets its own so optimizing one copy leaves the
+        //other alone
+        static void copy_operands(ir::ir_function& clone, ir::ir_operand_pool& operands);
+
+        //copies the constants into the parameters in a block of its own, the first block can be a loop header
+        static void bind_constants(ir::ir_function& function, const Constants& constants);
+    };
+}
@@ -0,0 +1,284 @@
+#include "jump_threading.hpp"
+
+#include <algorithm>
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes JumpThreading::apply(ir::ir_function& function, PassContext& context) {
+        auto& graph = function.graph;
+        Code code;
+        for (const auto& node : graph.nodes) {
+            //phis name their predecessors by block, and every block is rebuilt here
+            if (std::ranges::contains(node.instructions, ir::ir_opcode::Phi, &ir::ir_instruction::opcode))
+                return Changes::None;
+
+            code.insert(code.end(), node.instructions.begin(), node.instructions.end());
+        }
+
+        //one step can expose work for another, like a jump threaded to the label right after it
+        bool changed = false;
+        for (int round = 0; round < 8; ++round) {
+            bool round_changed = thread_jumps(code, function, context.analyses.side_effects());
+            round_changed |= remove_jumps_to_next(code);
+            round_changed |= remove_dead_code(code);
+            round_changed |= move_single_use_blocks(code);
+
+            if (!round_changed)
+                break;
+            changed = true;
+        }
+
+        if (!changed)
+            return Changes::None;
+
+        graph.generate_flowgraph(std::move(code));
+        return Changes::Cfg | Changes::Instructions;
+    }
+
+    bool JumpThreading::thread_jumps(Code& code, ir::ir_function& function, const SideEffects& side_effects) {
+        const auto labels = label_positions(code);
+        //labels to put in front of a position, and jumps to put after one
+        std::unordered_map<std::size_t, std::uint32_t> new_labels;
+        std::unordered_map<std::size_t, std::uint32_t> new_jumps;
+        bool changed = false;
+
+        for (std::size_t i = 0; i < code.size(); ++i) {
+            auto& instruction = code[i];
+            if (instruction.is_jump()) {
+                const auto target = resolve(code, labels, i, true, instruction.label(), side_effects, new_labels, function);
+                if (target.label != instruction.label()) {
+                    instruction.attribute = target.label;
+                    changed = true;
+                }
+            }
+
+            //falling into a label is free, a jump only pays off when it skips a test
+            if (ends_path(instruction) || i + 1 == code.size() || code[i + 1].opcode != ir::ir_opcode::Label)
+                continue;
+
+            const auto target = resolve(code, labels, i, false, code[i + 1].label(), side_effects, new_labels, function);
+            if (target.threaded) {
+                new_jumps[i] = target.label;
+                changed = true;
+            }
+        }
+
+        if (new_labels.empty() && new_jumps.empty())
+            return changed;
+
+        Code output;
+        output.reserve(code.size() + new_labels.size() + new_jumps.size());
+        for (std::size_t i = 0; i <= code.size(); ++i) {
+            if (const auto label = new_labels.find(i); label != new_labels.end())
+                output.push_back(ir::make_label(label->second));
+
+            if (i == code.size())
+                break;
+
+            output.push_back(code[i]);
+            if (const auto jump = new_jumps.find(i); jump != new_jumps.end())
+                output.push_back(ir::make_jump(jump->second));
+        }
+
+        code = std::move(output);
+        return true;
+    }
+
+    JumpThreading::Target JumpThreading::resolve(const Code& code, const std::unordered_map<std::uint32_t, std::size_t>& labels, const std::size_t source,
+                                                 const bool taken, const std::uint32_t label, const SideEffects& side_effects,
+                                                 std::unordered_map<std::size_t, std::uint32_t>& new_labels, ir::ir_function& function) {
+        Target target{label};
+
+        //a cycle of jumps never settles, so the walk is bounded
+        for (std::size_t steps = 0; steps < code.size(); ++steps) {
+            auto position = labels.at(target.label);
+            while (position < code.size() && code[position].opcode == ir::ir_opcode::Label)
+                ++position;
+
+            if (position == code.size())
+                return target;
+
+            const auto& next = code[position];
+            if (next.opcode == ir::ir_opcode::Jump) {
+                target.label = next.label();
+                continue;
+            }
+
+            if (!next.is_conditional_jump())
+                return target;
+
+            //only labels and jumps were passed, the value is still the one on the edge
+            const auto value = known_on_edge(code, source, taken, next.source(), side_effects);
+            if (!value.has_value())
+                return target;
+
+            target.threaded = true;
+            if (*value == (next.opcode == ir::ir_opcode::JumpIfNotZero)) {
+                target.label = next.label();
+                continue;
+            }
+
+            if (position + 1 < code.size() && code[position + 1].opcode == ir::ir_opcode::Label) {
+                target.label = code[position + 1].label();
+                continue;
+            }
+
+            auto [after, inserted] = new_labels.try_emplace(position + 1);
+            if (inserted)
+                after->second = function.create_label(ir::ir_label_kind::Threaded);
+            target.label = after->second;
+            return target;
+        }
+        return target;
+    }
+
+    std::optional<bool> JumpThreading::known_on_edge(const Code& code, const std::size_t position, const bool taken, const ir::ir_value& condition,
+                                                     const SideEffects& side_effects) {
+        const auto& instruction = code[position];
+        if (instruction.is_conditional_jump() && instruction.source() == condition)
+            return (instruction.opcode == ir::ir_opcode::JumpIfNotZero) == taken;
+
+        //back through the straight line code that leads here, a label means other ways in
+        auto current = instruction.is_jump() ? position : position + 1;
+        while (current-- > 0) {
+            const auto& previous = code[current];
+            if (previous.opcode == ir::ir_opcode::Label || ends_path(previous))
+                return std::nullopt;
+
+            //only reached by falling through, so the test failed
+            if (previous.is_conditional_jump() && previous.source() == condition)
+                return previous.opcode == ir::ir_opcode::JumpIfZero;
+
+            if (previous.opcode == ir::ir_opcode::Call && side_effects.is_global(condition))
+                return std::nullopt;
+
+            if (previous.has_result() && previous.result() == condition) {
+                if (previous.opcode == ir::ir_opcode::Copy && previous.source().is_constant())
+                    return previous.source().get_constant() != 0;
+                return std::nullopt;
+            }
+        }
+        return std::nullopt;
+    }
+
+    bool JumpThreading::remove_jumps_to_next(Code& code) {
+        const auto to_next = [&code](const std::size_t position) {
+            for (auto next = position + 1; next < code.size() && code[next].opcode == ir::ir_opcode::Label; ++next) {
+                if (code[next].label() == code[position].label())
+                    return true;
+            }
+            return false;
+        };
+
+        Code output;
+        output.reserve(code.size());
+        for (std::size_t i = 0; i < code.size(); ++i) {
+            if (!code[i].is_jump() || !to_next(i))
+                output.push_back(code[i]);
+        }
+
+        const bool changed = output.size() != code.size();
+        code = std::move(output);
+        return changed;
+    }
+
+    //labels no jump names are dropped too, the blocks around them merge
+    bool JumpThreading::remove_dead_code(Code& code) {
+        bool changed = false;
+
+        //a label only named by dead code becomes dead itself, so this repeats
+        while (true) {
+            const auto counts = jump_counts(code);
+            Code output;
+            output.reserve(code.size());
+
+            bool reachable = true;
+            for (const auto& instruction : code) {
+                if (instruction.opcode == ir::ir_opcode::Label) {
+                    if (!counts.contains(instruction.label()))
+                        continue;
+                    reachable = true;
+                }
+
+                if (!reachable)
+                    continue;
+
+                output.push_back(instruction);
+                if (ends_path(instruction))
+                    reachable = false;
+            }
+
+            if (output.size() == code.size())
+                return changed;
+
+            code = std::move(output);
+            changed = true;
+        }
+    }
+
+    bool JumpThreading::move_single_use_blocks(Code& code) {
+        bool changed = false;
+
+        //one block per scan, positions move with every change
+        bool moved = true;
+        while (moved) {
+            moved = false;
+            const auto counts = jump_counts(code);
+            const auto labels = label_positions(code);
+
+            for (std::size_t i = 0; i < code.size(); ++i) {
+                if (code[i].opcode != ir::ir_opcode::Jump || counts.at(code[i].label()) != 1)
+                    continue;
+
+                //nothing may fall into the block, and it may not fall out of it
+                const auto start = labels.at(code[i].label());
+                if (start == 0 || !ends_path(code[start - 1]))
+                    continue;
+
+                auto end = start + 1;
+                while (end < code.size() && code[end].opcode != ir::ir_opcode::Label && !code[end].is_jump() && !ends_path(code[end]))
+                    ++end;
+
+                if (end == code.size() || !ends_path(code[end]) || (i >= start && i <= end))
+                    continue;
+
+                Code output;
+                output.reserve(code.size());
+                for (std::size_t j = 0; j < code.size(); ++j) {
+                    if (j == i)
+                        output.insert(output.end(), code.begin() + static_cast<std::ptrdiff_t>(start) + 1, code.begin() + static_cast<std::ptrdiff_t>(end) + 1);
+                    else if (j < start || j > end)
+                        output.push_back(code[j]);
+                }
+
+                code = std::move(output);
+                moved = true;
+                changed = true;
+                break;
+            }
+        }
+        return changed;
+    }
+
+    std::unordered_map<std::uint32_t, std::size_t> JumpThreading::label_positions(const Code& code) {
+        std::unordered_map<std::uint32_t, std::size_t> positions;
+        for (std::size_t i = 0; i < code.size(); ++i) {
+            if (code[i].opcode == ir::ir_opcode::Label)
+                positions.emplace(code[i].label(), i);
+        }
+        return positions;
+    }
+
+    std::unordered_map<std::uint32_t, int> JumpThreading::jump_counts(const Code& code) {
+        std::unordered_map<std::uint32_t, int> counts;
+        for (const auto& instruction : code) {
+            if (instruction.is_jump())
+                ++counts[instruction.label()];
+        }
+        return counts;
+    }
+
+    bool JumpThreading::ends_path(const ir::ir_instruction& instruction) {
+        return instruction.opcode == ir::ir_opcode::Jump || instruction.opcode == ir::ir_opcode::Return;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "ir/ir.h"
+#include "ir/ir_function.h"
+#include "optimizations/analysis/side_effects.hpp"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Shortens branch chains, on the flattened instructions of a function that is not in SSA form. A jump to a jump
+    //goes to the final target. A jump to a conditional jump on a value known along that edge, from a constant copy
+    //or from the branch taken to get there, goes straight to the side that is taken. Jumps to the next instruction,
+    //code no jump reaches and labels no jump names are removed, which merges blocks that follow each other. A block
+    //only reached by one jump and ending in a jump or a return is moved in place of that jump
+    class JumpThreading : public Pass {
+    public:
+        using Code = std::vector<ir::ir_instruction>;
+
+        [[nodiscard]] std::string_view name() const override {
+            return "jump-threading";
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
+
+    private:
+        struct Target {
+            std::uint32_t label;
+            //a conditional jump on the way was decided by the known value
+            bool threaded = false;
+        };
+
+        static bool thread_jumps(Code& code, ir::ir_function& function, const SideEffects& side_effects);
+
+        //where the edge leaving source for label ends up
+        static Target resolve(const Code& code, const std::unordered_map<std::uint32_t, std::size_t>& labels, std::size_t source, bool taken,
+                              std::uint32_t label, const SideEffects& side_effects, std::unordered_map<std::size_t, std::uint32_t>& new_labels,
+                              ir::ir_function& function);
+
+        //true when the condition is not zero on the edge leaving position, through its jump when taken and by falling
+        //through otherwise
+        static std::optional<bool> known_on_edge(const Code& code, std::size_t position, bool taken, const ir::ir_value& condition,
+                                                 const SideEffects& side_effects);
+
+        static bool remove_jumps_to_next(Code& code);
+
+        static bool remove_dead_code(Code& code);
+
+        static bool move_single_use_blocks(Code& code);
+
+        static std::unordered_map<std::uint32_t, std::size_t> label_positions(const Code& code);
+
+        static std::unordered_map<std::uint32_t, int> jump_counts(const Code& code);
+
+        static bool ends_path(const ir::ir_instruction& instruction);
+    };
+}
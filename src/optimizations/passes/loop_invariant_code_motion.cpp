@@ -0,0 +1,195 @@
+#include "loop_invariant_code_motion.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes LoopInvariantCodeMotion::apply(ir::ir_function& function, PassContext& context) {
+        auto& graph = function.graph;
+        const auto& side_effects = context.analyses.side_effects();
+
+        definition_counts.clear();
+        for (const auto& node : graph.nodes) {
+            for (const auto& instruction : node.instructions) {
+                if (instruction.has_result())
+                    ++definition_counts[instruction.result()];
+            }
+        }
+
+        //a copy, creating a preheader drops the loops cached by the graph
+        auto loops = graph.loops().loops();
+        Changes changes = Changes::None;
+
+        for (auto index = loops.size(); index-- > 0;) {
+            const auto& loop = loops[index];
+            const auto invariants = find_invariants(graph, loop, side_effects);
+            if (invariants.empty())
+                continue;
+
+            auto preheader = loop.preheader;
+            if (preheader == INVALID) {
+                preheader = create_preheader(function, loop, context.program.operands);
+                if (preheader == INVALID)
+                    continue;
+
+                //the new block is part of every loop around this one
+                for (auto parent = loop.parent; parent != LoopInfo::NO_LOOP; parent = loops[parent].parent)
+                    loops[parent].blocks.push_back(preheader);
+                changes |= Changes::Cfg;
+            }
+
+            std::unordered_set<ir::ir_value> moved;
+            for (const auto& instruction : invariants)
+                moved.insert(instruction.result());
+
+            for (const auto block : loop.blocks) {
+                std::erase_if(graph.get_node_from_id(block).instructions, [&moved](const ir::ir_instruction& instruction) {
+                    return (instruction.opcode == ir::ir_opcode::Binary || instruction.opcode == ir::ir_opcode::Unary)
+                           && moved.contains(instruction.result());
+                });
+            }
+
+            auto& instructions = graph.get_node_from_id(preheader).instructions;
+            auto position = instructions.end();
+            if (!instructions.empty() && instructions.back().is_jump())
+                --position;
+            instructions.insert(position, invariants.begin(), invariants.end());
+            changes |= Changes::Removed | Changes::Inserted;
+        }
+
+        return changes;
+    }
+
+    std::vector<ir::ir_instruction> LoopInvariantCodeMotion::find_invariants(const FlowGraphType& graph, const Loop& loop, const SideEffects& side_effects) {
+        std::unordered_set<ir::ir_value> defined_in_loop;
+        bool calls_impure = false;
+        for (const auto block : loop.blocks) {
+            for (const auto& instruction : graph.get_node_from_id(block).instructions) {
+                if (instruction.has_result())
+                    defined_in_loop.insert(instruction.result());
+
+                if (instruction.opcode == ir::ir_opcode::Call && !side_effects.is_pure(instruction.callee()))
+                    calls_impure = true;
+            }
+        }
+
+        //a global the loop never assigns can still be written by a call in it
+        const auto is_invariant = [&](const ir::ir_value& value) {
+            return value.is_constant() || (!defined_in_loop.contains(value) && !(calls_impure && side_effects.is_global(value)));
+        };
+
+        //definitions come before their uses in reverse postorder, so one sweep also finds invariants built on invariants
+        auto blocks = loop.blocks;
+        std::ranges::sort(blocks, [&graph](const int left, const int right) {
+            return graph.rpo_number(left) < graph.rpo_number(right);
+        });
+
+        std::vector<ir::ir_instruction> invariants;
+        for (const auto block : blocks) {
+            for (const auto& instruction : graph.get_node_from_id(block).instructions) {
+                if (instruction.opcode != ir::ir_opcode::Binary && instruction.opcode != ir::ir_opcode::Unary)
+                    continue;
+
+                //the result has to be the only definition, or the value after the loop would change
+                const auto result = instruction.result();
+                if (definition_counts[result] != 1 || side_effects.is_global(result))
+                    continue;
+
+                bool operands_invariant = true;
+                for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot)
+                    operands_invariant &= is_invariant(instruction.operand(slot));
+
+                if (!operands_invariant || (can_trap(instruction) && !is_guaranteed(graph, loop, block)))
+                    continue;
+
+                invariants.push_back(instruction);
+                defined_in_loop.erase(result);
+            }
+        }
+
+        return invariants;
+    }
+
+    int LoopInvariantCodeMotion::create_preheader(ir::ir_function& function, const Loop& loop, ir::ir_operand_pool& operands) {
+        auto& graph = function.graph;
+        auto& header = graph.get_node_from_id(loop.header);
+
+        std::vector<int> outside;
+        for (const auto predecessor : header.predecessors) {
+            if (!std::ranges::contains(loop.blocks, predecessor) && !std::ranges::contains(outside, predecessor))
+                outside.push_back(predecessor);
+        }
+
+        //several entries would need phis in the preheader, those loops are left alone
+        if (outside.size() != 1)
+            return INVALID;
+
+        const auto entry_id = outside.front();
+        const auto previous_id = graph.layout_predecessor(loop.header);
+        const bool header_has_label = !header.instructions.empty() && header.instructions.front().opcode == ir::ir_opcode::Label;
+        const auto header_label = header_has_label ? header.instructions.front().label() : 0;
+
+        const auto& entry = graph.get_node_from_id(entry_id);
+        const bool jump_edge = entry_id != ENTRY && header_has_label && !entry.instructions.empty() && entry.instructions.back().is_jump()
+                               && entry.instructions.back().label() == header_label;
+
+        int preheader;
+        if (!jump_edge) {
+            //the entry falls through into the header, the preheader goes between the two
+            if (previous_id != entry_id)
+                return INVALID;
+
+            preheader = graph.add_node({}, loop.header);
+        } else {
+            //the preheader is placed before the header, whatever fell through into the header must not fall into it
+            const auto& previous = graph.get_node_from_id(previous_id);
+            const bool previous_falls_through = previous_id == ENTRY || previous.instructions.empty()
+                                                || (previous.instructions.back().opcode != ir::ir_opcode::Jump
+                                                    && previous.instructions.back().opcode != ir::ir_opcode::Return);
+            if (previous_falls_through)
+                return INVALID;
+
+            const auto label = function.create_label(ir::ir_label_kind::Preheader);
+            preheader = graph.add_node({ir::make_label(label)}, loop.header);
+            graph.get_node_from_id(entry_id).instructions.back().attribute = label;
+        }
+
+        graph.remove_edge(entry_id, loop.header);
+        graph.add_edge(entry_id, preheader);
+        graph.add_edge(preheader, loop.header);
+
+        //phis of the header now receive the outside value from the preheader
+        for (const auto& instruction : graph.get_node_from_id(loop.header).instructions) {
+            if (instruction.opcode != ir::ir_opcode::Phi)
+                continue;
+
+            auto incoming = operands.incoming(instruction);
+            for (std::size_t i = 0; i < incoming.size(); i += 2) {
+                if (incoming[i + 1].get_constant() == entry_id)
+                    incoming[i + 1] = ir::ir_value{preheader};
+            }
+        }
+
+        return preheader;
+    }
+
+    //the block runs on every trip through the loop that leaves it
+    bool LoopInvariantCodeMotion::is_guaranteed(const FlowGraphType& graph, const Loop& loop, const int block_id) {
+        if (block_id == loop.header)
+            return true;
+
+        const auto& dominators = graph.dominators();
+        return !loop.exits.empty() && std::ranges::all_of(loop.exits, [&](const std::pair<int, int>& exit) {
+            return dominators.dominates(block_id, exit.first);
+        });
+    }
+
+    bool LoopInvariantCodeMotion::can_trap(const ir::ir_instruction& instruction) {
+        if (instruction.opcode != ir::ir_opcode::Binary || (instruction.op() != token_type::Slash && instruction.op() != token_type::Percent))
+            return false;
+
+        const auto divisor = instruction.right();
+        return !divisor.is_constant() || divisor.get_constant() == 0 || divisor.get_constant() == -1;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "flow_graph/flow_graph.hpp"
+#include "flow_graph/loop_info.hpp"
+#include "ir/ir.h"
+#include "ir/ir_function.h"
+#include "optimizations/analysis/side_effects.hpp"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Moves binary and unary instructions whose operands are not redefined in the loop to its preheader, inner loops
+    //first so their invariants can keep moving out. A preheader is created in front of the header when the loop is
+    //entered from a single block that does not already qualify. A division is only moved when its divisor is a safe
+    //constant or its block runs before every exit, so no trap is introduced on a path that never divided
+    class LoopInvariantCodeMotion : public Pass {
+    public:
+        using FlowGraphType = FlowGraph<ir::ir_instruction>;
+        using NodeType = Node<ir::ir_instruction>;
+
+        [[nodiscard]] std::string_view name() const override {
+            return "loop-invariant-code-motion";
+        }
+
+        [[nodiscard]] Analysis required_analyses() const override {
+            return Analysis::Loops;
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
+
+    private:
+        std::unordered_map<ir::ir_value, int> definition_counts;
+
+        std::vector<ir::ir_instruction> find_invariants(const FlowGraphType& graph, const Loop& loop, const SideEffects& side_effects);
+
+        int create_preheader(ir::ir_function& function, const Loop& loop, ir::ir_operand_pool& operands);
+
+        static bool is_guaranteed(const FlowGraphType& graph, const Loop& loop, int block_id);
+
+        static bool can_trap(const ir::ir_instruction& instruction);
+    };
+}
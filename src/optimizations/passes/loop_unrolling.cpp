@@ -0,0 +1,470 @@
+#include "loop_unrolling.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <ranges>
+#include "induction_variables.hpp"
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes LoopUnrolling::apply(ir::ir_function& function, PassContext& context) {
+        auto& graph = function.graph;
+        const auto& side_effects = context.analyses.side_effects();
+        const auto& loops = graph.loops().loops();
+
+        //innermost loops are disjoint, so all of them are picked before the first one changes the graph
+        std::vector<CountedLoop> candidates;
+        for (std::size_t index = 0; index < loops.size(); ++index) {
+            const bool innermost = std::ranges::none_of(loops, [index](const Loop& other) {
+                return other.parent == static_cast<int>(index);
+            });
+
+            if (!innermost)
+                continue;
+
+            if (auto counted = analyze(graph, loops[index], context.program.operands, side_effects))
+                candidates.push_back(std::move(*counted));
+        }
+
+        Changes changes = Changes::None;
+        for (const auto& counted : candidates) {
+            //a loop that never runs is left to constant propagation
+            const auto trips = counted.trip_count.value_or(0);
+            if (trips > 0 && trips <= options.max_full_trips && trips * counted.size <= options.full_budget) {
+                unroll_fully(function, counted, static_cast<int>(trips), context.program, side_effects);
+                changes |= Changes::Cfg | Changes::Inserted | Changes::Removed | Changes::Rewritten;
+                continue;
+            }
+
+            const auto factor = std::min(options.max_factor, options.partial_budget / counted.size);
+            if (factor < 2)
+                continue;
+
+            unroll_partially(function, counted, factor, context.program, side_effects);
+            changes |= Changes::Cfg | Changes::Inserted | Changes::Rewritten;
+        }
+
+        if (changes & Changes::Removed)
+            graph.compact();
+
+        return changes;
+    }
+
+    std::optional<LoopUnrolling::CountedLoop> LoopUnrolling::analyze(const FlowGraphType& graph, const Loop& loop, const ir::ir_operand_pool& operands,
+                                                                     const SideEffects& side_effects) {
+        if (loop.latches.size() != 1 || loop.preheader == INVALID || loop.exits.size() != 1 || loop.exits.front().first != loop.header)
+            return {};
+
+        const auto& header = graph.get_node_from_id(loop.header).instructions;
+        const auto latch = loop.latches.front();
+        const auto& latch_code = graph.get_node_from_id(latch).instructions;
+        const auto& preheader_code = graph.get_node_from_id(loop.preheader).instructions;
+        if (latch == loop.header || header.empty() || header.front().opcode != ir::ir_opcode::Label || latch_code.empty()
+            || latch_code.back().opcode != ir::ir_opcode::Jump || latch_code.back().label() != header.front().label()
+            || (!preheader_code.empty() && preheader_code.back().is_conditional_jump()))
+            return {};
+
+        //copies are laid out like the original, so the loop has to be contiguous to keep its fall throughs
+        std::vector<int> blocks;
+        for (auto position = graph.position_of(loop.header); blocks.size() < loop.blocks.size() && position < graph.nodes.size(); ++position) {
+            const auto& node = graph.nodes[position];
+            if (node.removed)
+                continue;
+
+            if (!std::ranges::contains(loop.blocks, node.id))
+                return {};
+            blocks.push_back(node.id);
+        }
+
+        if (blocks.size() != loop.blocks.size() || blocks.back() != latch)
+            return {};
+
+        const auto exit = loop.exits.front().second;
+        const auto& branch = header.back();
+        const auto& successors = graph.get_node_from_id(loop.header).successors;
+        if (exit == EXIT || branch.opcode != ir::ir_opcode::JumpIfZero || graph.label_to_block_id(branch.label()) != exit || successors.size() != 2
+            || successors.front() == successors.back())
+            return {};
+
+        std::unordered_map<ir::ir_value, ir::ir_instruction> definitions;
+        std::unordered_map<ir::ir_value, int> definition_counts;
+        int size = 0;
+        for (const auto block : blocks) {
+            for (const auto& instruction : graph.get_node_from_id(block).instructions) {
+                if (instruction.has_result()) {
+                    definitions[instruction.result()] = instruction;
+                    ++definition_counts[instruction.result()];
+                }
+
+                if (instruction.opcode != ir::ir_opcode::Label && instruction.opcode != ir::ir_opcode::Phi && !instruction.is_jump())
+                    ++size;
+            }
+        }
+
+        CountedLoop counted{loop.header, loop.preheader, latch, successors.front() == exit ? successors.back() : successors.front(), exit, blocks};
+        counted.size = std::max(size, 1);
+
+        const auto phis = header_phis(graph, counted, operands);
+        const auto condition = definitions.find(branch.source());
+        if (!phis.has_value() || condition == definitions.end() || condition->second.opcode != ir::ir_opcode::Binary)
+            return {};
+
+        const auto is_invariant = [&](const ir::ir_value& value) {
+            return value.is_constant() || (!definitions.contains(value) && !side_effects.is_global(value));
+        };
+
+        //a basic induction variable: the back edge value is the phi plus a constant, through copies
+        const auto step_of = [&](const HeaderPhi& phi) -> std::optional<int> {
+            auto value = phi.back;
+            while (definitions.contains(value) && definition_counts.at(value) == 1 && definitions.at(value).opcode == ir::ir_opcode::Copy)
+                value = definitions.at(value).source();
+
+            const auto it = definitions.find(value);
+            if (it == definitions.end() || definition_counts.at(value) != 1 || it->second.opcode != ir::ir_opcode::Binary)
+                return {};
+
+            const auto& increment = it->second;
+            if (increment.op() == token_type::Plus && increment.left() == phi.result && increment.right().is_constant())
+                return increment.right().get_constant();
+            if (increment.op() == token_type::Plus && increment.right() == phi.result && increment.left().is_constant())
+                return increment.left().get_constant();
+            if (increment.op() == token_type::Minus && increment.left() == phi.result && increment.right().is_constant()
+                && increment.right().get_constant() != std::numeric_limits<int>::min())
+                return -increment.right().get_constant();
+            return {};
+        };
+
+        const auto& compare = condition->second;
+        for (const auto& phi : *phis) {
+            const bool variable_left = compare.left() == phi.result;
+            if (!variable_left && compare.right() != phi.result)
+                continue;
+
+            const auto step = step_of(phi);
+            const auto bound = variable_left ? compare.right() : compare.left();
+            const auto op = variable_left ? compare.op() : InductionVariables::mirror(compare.op());
+            if (!step.has_value() || !is_invariant(bound))
+                return {};
+
+            //the variable has to move towards the bound, the tests below rely on it
+            const bool counts_up = (op == token_type::Less || op == token_type::LessEqual) && *step > 0;
+            const bool counts_down = (op == token_type::Greater || op == token_type::GreaterEqual) && *step < 0;
+            if (!counts_up && !counts_down)
+                return {};
+
+            counted.variable = phi.result;
+            counted.bound = bound;
+            counted.op = op;
+            counted.step = *step;
+            if (phi.init.is_constant() && bound.is_constant())
+                counted.trip_count = trip_count(phi.init.get_constant(), bound.get_constant(), op, *step);
+            return counted;
+        }
+        return {};
+    }
+
+    void LoopUnrolling::unroll_fully(ir::ir_function& function, const CountedLoop& counted, const int trips, ir::ir_program& program,
+                                     const SideEffects& side_effects) {
+        auto& graph = function.graph;
+        const auto phis = *header_phis(graph, counted, program.operands);
+
+        std::unordered_map<ir::ir_value, ir::ir_value> values;
+        for (const auto& phi : phis)
+            values[phi.result] = phi.init;
+
+        int previous_latch = INVALID;
+        for (int i = 0; i < trips; ++i) {
+            auto iteration = clone_iteration(function, counted, values, counted.header, program, side_effects);
+            if (previous_latch == INVALID)
+                retarget_entry(graph, counted, iteration.first, iteration.label);
+            else
+                link(graph, previous_latch, iteration.first, iteration.label);
+
+            for (const auto& phi : phis) {
+                const auto it = iteration.values.find(phi.back);
+                values[phi.result] = it == iteration.values.end() ? phi.back : it->second;
+            }
+            previous_latch = iteration.latch;
+        }
+
+        //the test fails after the last copy, the header is left to hand the final values to the code after the loop
+        auto& header = graph.get_node_from_id(counted.header).instructions;
+        link(graph, previous_latch, counted.header, header.front().label());
+        for (auto& instruction : header) {
+            if (instruction.opcode == ir::ir_opcode::Phi)
+                instruction = ir::make_copy(instruction.result(), values.at(instruction.result()));
+        }
+        header.back() = ir::make_jump(header.back().label());
+
+        graph.remove_edge(counted.header, counted.body_entry);
+        for (const auto block : counted.blocks | std::views::drop(1))
+            graph.remove_node(block);
+    }
+
+    void LoopUnrolling::unroll_partially(ir::ir_function& function, const CountedLoop& counted, const int factor, ir::ir_program& program,
+                                         const SideEffects& side_effects) {
+        auto& graph = function.graph;
+        const auto phis = *header_phis(graph, counted, program.operands);
+        const auto suffix = ".u" + std::to_string(copies++);
+        const auto header_label = graph.get_node_from_id(counted.header).instructions.front().label();
+
+        //the new loop keeps its own copy of every header phi
+        std::unordered_map<ir::ir_value, ir::ir_value> values;
+        for (const auto& phi : phis)
+            values[phi.result] = fresh_value(phi.result, suffix, program);
+
+        const auto current = values.at(counted.variable);
+        const auto test = [&](const token_type op, const ir::ir_value& left, const ir::ir_value& right) {
+            const auto result = program.make_temporary();
+            return std::vector{ir::make_binary(op, left, right, result), ir::make_jump_if_zero(result, header_label)};
+        };
+
+        //a round runs factor copies, so the variable must still pass the test after moving distance further.
+        //With a constant bound that is one test against a moved bound. Otherwise the distance left to the bound is
+        //compared once the variable is known to pass, it is positive then and only wraps into a failing test
+        const std::int64_t distance = std::int64_t{factor - 1} * counted.step;
+        std::vector<std::vector<ir::ir_instruction> > guards;
+        const auto moved_bound = counted.bound.is_constant() ? counted.bound.get_constant() - distance : std::int64_t{0};
+        if (counted.bound.is_constant() && moved_bound >= std::numeric_limits<int>::min() && moved_bound <= std::numeric_limits<int>::max()) {
+            guards.push_back(test(counted.op, current, ir::ir_value{static_cast<int>(moved_bound)}));
+        } else {
+            const bool strict = counted.op == token_type::Less || counted.op == token_type::Greater;
+            const auto remaining = program.make_temporary();
+            guards.push_back(test(counted.op, current, counted.bound));
+            guards.push_back(counted.step > 0 ? std::vector{ir::make_binary(token_type::Minus, counted.bound, current, remaining)}
+                                              : std::vector{ir::make_binary(token_type::Minus, current, counted.bound, remaining)});
+
+            auto check = test(strict ? token_type::Greater : token_type::GreaterEqual, remaining, ir::ir_value{static_cast<int>(std::abs(distance))});
+            guards.back().insert(guards.back().end(), check.begin(), check.end());
+        }
+
+        const auto label = function.create_label(ir::ir_label_kind::WhileCond);
+        std::vector<int> guard_ids;
+        for (std::size_t i = 0; i < guards.size(); ++i) {
+            std::vector<ir::ir_instruction> code;
+            if (i == 0)
+                code.push_back(ir::make_label(label));
+            guard_ids.push_back(graph.add_node(std::move(code), counted.header));
+        }
+
+        retarget_entry(graph, counted, guard_ids.front(), label);
+
+        int previous_latch = INVALID;
+        auto iteration_values = values;
+        for (int i = 0; i < factor; ++i) {
+            auto iteration = clone_iteration(function, counted, iteration_values, counted.header, program, side_effects);
+            if (previous_latch == INVALID)
+                graph.add_edge(guard_ids.back(), iteration.first);
+            else
+                link(graph, previous_latch, iteration.first, iteration.label);
+
+            for (const auto& phi : phis) {
+                const auto it = iteration.values.find(phi.back);
+                iteration_values[phi.result] = it == iteration.values.end() ? phi.back : it->second;
+            }
+            previous_latch = iteration.latch;
+        }
+        link(graph, previous_latch, guard_ids.front(), label);
+
+        auto& first_guard = graph.get_node_from_id(guard_ids.front()).instructions;
+        for (const auto& phi : phis) {
+            const std::vector incoming{phi.init, ir::ir_value{counted.preheader}, iteration_values.at(phi.result), ir::ir_value{previous_latch}};
+            first_guard.push_back(ir::make_phi(values.at(phi.result), program.operands.append(incoming), 2));
+        }
+
+        for (std::size_t i = 0; i < guards.size(); ++i) {
+            auto& code = graph.get_node_from_id(guard_ids[i]).instructions;
+            code.insert(code.end(), guards[i].begin(), guards[i].end());
+
+            graph.add_edge(guard_ids[i], counted.header);
+            if (i + 1 < guards.size())
+                graph.add_edge(guard_ids[i], guard_ids[i + 1]);
+        }
+
+        //the original loop runs what is left, entered from any of the guards instead of the preheader
+        for (auto& instruction : graph.get_node_from_id(counted.header).instructions) {
+            if (instruction.opcode != ir::ir_opcode::Phi)
+                continue;
+
+            const auto& phi = *std::ranges::find(phis, instruction.result(), &HeaderPhi::result);
+            std::vector incoming{phi.back, ir::ir_value{counted.latch}};
+            for (const auto guard : guard_ids) {
+                incoming.push_back(values.at(phi.result));
+                incoming.emplace_back(guard);
+            }
+            instruction = ir::make_phi(phi.result, program.operands.append(incoming), static_cast<std::uint32_t>(incoming.size() / 2));
+        }
+    }
+
+    LoopUnrolling::Iteration LoopUnrolling::clone_iteration(ir::ir_function& function, const CountedLoop& counted,
+                                                            std::unordered_map<ir::ir_value, ir::ir_value> values, const int before_id,
+                                                            ir::ir_program& program, const SideEffects& side_effects) {
+        auto& graph = function.graph;
+        const auto suffix = ".u" + std::to_string(copies++);
+
+        //results get their names first, a phi in the body can read a value defined further down
+        for (const auto block : counted.blocks) {
+            for (const auto& instruction : graph.get_node_from_id(block).instructions) {
+                if (instruction.has_result() && !values.contains(instruction.result()) && !side_effects.is_global(instruction.result()))
+                    values[instruction.result()] = fresh_value(instruction.result(), suffix, program);
+            }
+        }
+
+        const auto lookup = [&values](const ir::ir_value& value) {
+            const auto it = values.find(value);
+            return it == values.end() ? value : it->second;
+        };
+
+        //blocks are created with their labels so the graph finds them, the rest is filled in once every id is known
+        Iteration iteration{};
+        iteration.label = function.create_label(ir::ir_label_kind::Unrolled);
+        iteration.first = graph.add_node({ir::make_label(iteration.label)}, before_id);
+
+        std::unordered_map<int, int> ids{{counted.header, iteration.first}};
+        std::unordered_map<std::uint32_t, std::uint32_t> labels;
+        for (const auto block : counted.blocks | std::views::drop(1)) {
+            std::vector<ir::ir_instruction> code;
+            const auto& original = graph.get_node_from_id(block).instructions;
+            if (!original.empty() && original.front().opcode == ir::ir_opcode::Label) {
+                const auto label = function.create_label(function.labels[original.front().label()]);
+                labels[original.front().label()] = label;
+                code.push_back(ir::make_label(label));
+            }
+            ids[block] = graph.add_node(std::move(code), before_id);
+        }
+
+        for (const auto block : counted.blocks) {
+            std::vector<ir::ir_instruction> code;
+            for (auto instruction : graph.get_node_from_id(block).instructions) {
+                if (instruction.opcode == ir::ir_opcode::Label)
+                    continue;
+
+                //the header phis are already in the values, its exit test is not repeated
+                if (block == counted.header && (instruction.opcode == ir::ir_opcode::Phi || instruction.is_jump()))
+                    continue;
+
+                if (instruction.opcode == ir::ir_opcode::Phi) {
+                    std::vector<ir::ir_value> incoming;
+                    const auto original = program.operands.incoming(instruction);
+                    for (std::size_t i = 0; i < original.size(); i += 2) {
+                        incoming.push_back(lookup(original[i]));
+                        incoming.emplace_back(ids.at(original[i + 1].get_constant()));
+                    }
+                    code.push_back(ir::make_phi(lookup(instruction.result()), program.operands.append(incoming), instruction.argument_count()));
+                    continue;
+                }
+
+                if (instruction.opcode == ir::ir_opcode::Call) {
+                    std::vector<ir::ir_value> arguments;
+                    for (const auto& argument : program.operands.arguments(instruction))
+                        arguments.push_back(lookup(argument));
+
+                    const auto offset = program.operands.append(arguments);
+                    code.push_back(ir::make_call(instruction.callee(), offset, instruction.argument_count(), lookup(instruction.result())));
+                    continue;
+                }
+
+                //the back edge is pointed at the next copy by the caller
+                if (instruction.is_jump())
+                    instruction.attribute = block == counted.latch && instruction.opcode == ir::ir_opcode::Jump ? iteration.label : labels.at(instruction.label());
+
+                for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot)
+                    instruction.set_operand(slot, lookup(instruction.operand(slot)));
+
+                if (instruction.has_result())
+                    instruction.set_result(lookup(instruction.result()));
+
+                code.push_back(instruction);
+            }
+
+            auto& copy = graph.get_node_from_id(ids.at(block)).instructions;
+            copy.insert(copy.end(), code.begin(), code.end());
+        }
+
+        for (const auto block : counted.blocks) {
+            for (const auto successor : graph.get_node_from_id(block).successors) {
+                if (block == counted.header ? successor == counted.body_entry : successor != counted.header)
+                    graph.add_edge(ids.at(block), ids.at(successor));
+            }
+        }
+
+        iteration.latch = ids.at(counted.latch);
+        iteration.values = std::move(values);
+        return iteration;
+    }
+
+    ir::ir_value LoopUnrolling::fresh_value(const ir::ir_value& value, const std::string& suffix, ir::ir_program& program) {
+        if (value.is_temporary())
+            return program.make_temporary();
+
+        return ir::ir_value::variable(program.symbols.intern(program.symbols.value_to_string(value) + suffix));
+    }
+
+    std::optional<std::vector<LoopUnrolling::HeaderPhi> > LoopUnrolling::header_phis(const FlowGraphType& graph, const CountedLoop& counted,
+                                                                                     const ir::ir_operand_pool& operands) {
+        std::vector<HeaderPhi> phis;
+        for (const auto& instruction : graph.get_node_from_id(counted.header).instructions) {
+            if (instruction.opcode != ir::ir_opcode::Phi)
+                continue;
+
+            const auto incoming = operands.incoming(instruction);
+            if (incoming.size() != 4)
+                return {};
+
+            HeaderPhi phi{instruction.result()};
+            for (std::size_t i = 0; i < incoming.size(); i += 2) {
+                if (incoming[i + 1].get_constant() == counted.preheader)
+                    phi.init = incoming[i];
+                else if (incoming[i + 1].get_constant() == counted.latch)
+                    phi.back = incoming[i];
+                else
+                    return {};
+            }
+            phis.push_back(phi);
+        }
+        return phis;
+    }
+
+    void LoopUnrolling::link(FlowGraphType& graph, const int latch, const int target, const std::uint32_t target_label) {
+        graph.get_node_from_id(latch).instructions.back() = ir::make_jump(target_label);
+        graph.add_edge(latch, target);
+    }
+
+    //the preheader either falls through into the header, then the new code is laid out right after it, or jumps
+    void LoopUnrolling::retarget_entry(FlowGraphType& graph, const CountedLoop& counted, const int target, const std::uint32_t target_label) {
+        auto& preheader = graph.get_node_from_id(counted.preheader).instructions;
+        if (!preheader.empty() && preheader.back().opcode == ir::ir_opcode::Jump)
+            preheader.back() = ir::make_jump(target_label);
+
+        graph.remove_edge(counted.preheader, counted.header);
+        graph.add_edge(counted.preheader, target);
+    }
+
+    std::optional<std::int64_t> LoopUnrolling::trip_count(const std::int64_t init, const std::int64_t bound, const token_type op, const std::int64_t step) {
+        std::int64_t trips;
+        switch (op) {
+        case token_type::Less:
+            trips = init < bound ? (bound - init + step - 1) / step : 0;
+            break;
+        case token_type::LessEqual:
+            trips = init <= bound ? (bound - init) / step + 1 : 0;
+            break;
+        case token_type::Greater:
+            trips = init > bound ? (init - bound - step - 1) / -step : 0;
+            break;
+        case token_type::GreaterEqual:
+            trips = init >= bound ? (init - bound) / -step + 1 : 0;
+            break;
+        default:
+            return {};
+        }
+
+        //the variable is stepped once more than the body runs, that value has to fit as well
+        const auto last = init + trips * step;
+        if (last < std::numeric_limits<int>::min() || last > std::numeric_limits<int>::max())
+            return {};
+
+        return trips;
+    }
+}
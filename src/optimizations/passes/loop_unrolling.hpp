@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "flow_graph/flow_graph.hpp"
+#include "flow_graph/loop_info.hpp"
+#include "ir/ir.h"
+#include "ir/ir_function.h"
+#include "lexer/token.h"
+#include "optimizations/analysis/side_effects.hpp"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Unrolls counted innermost loops, on SSA form. A counted loop only exits from its header, on a comparison of a
+    //basic induction variable against an invariant bound. With a constant trip count small enough the loop is
+    //replaced by one copy of its body per iteration. Otherwise the factor is picked from the body size and a new
+    //loop running that many copies per round goes in front of the original one, which is kept for the remainder.
+    //A round only starts when the distance left to the bound covers all of its copies
+    class LoopUnrolling : public Pass {
+    public:
+        using FlowGraphType = FlowGraph<ir::ir_instruction>;
+        using NodeType = Node<ir::ir_instruction>;
+
+        struct Options {
+            //largest trip count that is unrolled completely
+            int max_full_trips = 16;
+            //instructions a completely unrolled loop may have
+            int full_budget = 96;
+            int max_factor = 4;
+            //instructions the body of a partially unrolled loop may grow to
+            int partial_budget = 48;
+        };
+
+        LoopUnrolling() = default;
+
+        explicit LoopUnrolling(const Options options)
+            : options(options) {}
+
+        [[nodiscard]] std::string_view name() const override {
+            return "loop-unrolling";
+        }
+
+        [[nodiscard]] Analysis required_analyses() const override {
+            return Analysis::Loops;
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
+
+    private:
+        struct CountedLoop {
+            int header;
+            int preheader;
+            int latch;
+            int body_entry;
+            int exit;
+            //header first and the latch last, in layout order
+            std::vector<int> blocks;
+            ir::ir_value variable;
+            ir::ir_value bound;
+            //the comparison with the induction variable on the left
+            token_type op;
+            int step;
+            int size;
+            std::optional<std::int64_t> trip_count;
+        };
+
+        struct HeaderPhi {
+            ir::ir_value result;
+            ir::ir_value init;
+            ir::ir_value back;
+        };
+
+        //one copy of the header and the body, the header phis read the values of the previous copy
+        struct Iteration {
+            int first;
+            std::uint32_t label;
+            int latch;
+            std::unordered_map<ir::ir_value, ir::ir_value> values;
+        };
+
+        Options options;
+        //numbers the copies, keeps the renamed variables of different copies apart
+        std::uint32_t copies = 0;
+
+        [[nodiscard]] static std::optional<CountedLoop> analyze(const FlowGraphType& graph, const Loop& loop, const ir::ir_operand_pool& operands,
+                                                                const SideEffects& side_effects);
+
+        void unroll_fully(ir::ir_function& function, const CountedLoop& counted, int trips, ir::ir_program& program, const SideEffects& side_effects);
+
+        void unroll_partially(ir::ir_function& function, const CountedLoop& counted, int factor, ir::ir_program& program,
+                              const SideEffects& side_effects);
+
+        Iteration clone_iteration(ir::ir_function& function, const CountedLoop& counted, std::unordered_map<ir::ir_value, ir::ir_value> values,
+                                  int before_id, ir::ir_program& program, const SideEffects& side_effects);
+
+        static ir::ir_value fresh_value(const ir::ir_value& value, const std::string& suffix, ir::ir_program& program);
+
+        //nullopt when a phi has other incoming values than the preheader and the latch
+        static std::optional<std::vector<HeaderPhi> > header_phis(const FlowGraphType& graph, const CountedLoop& counted, const ir::ir_operand_pool& operands);
+
+        static void link(FlowGraphType& graph, int latch, int target, std::uint32_t target_label);
+
+        static void retarget_entry(FlowGraphType& graph, const CountedLoop& counted, int target, std::uint32_t target_label);
+
+        static std::optional<std::int64_t> trip_count(std::int64_t init, std::int64_t bound, token_type op, std::int64_t step);
+    };
+}
@@ -0,0 +1,226 @@
+#include "ssa_construction.hpp"
+
+#include <unordered_set>
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes SsaConstruction::apply(ir::ir_function& function, PassContext& context) {
+        phi_values.assign(static_cast<std::size_t>(function.graph.max_node_id()) + 2, {});
+        definition_counts.clear();
+        current_names.clear();
+        changes = Changes::None;
+
+        //the arguments are the first value of a parameter, a single assignment in the body already makes it two
+        for (const auto& parameter : function.parameters)
+            ++definition_counts[parameter];
+
+        place_phis(function.graph, context.program.operands, context.analyses.side_effects());
+        rename(function.graph, context.program.symbols, context.program.operands);
+        return changes;
+    }
+
+    void SsaConstruction::place_phis(FlowGraphType& graph, ir::ir_operand_pool& operands, const SideEffects& side_effects) {
+        const auto& dominators = graph.dominators();
+
+        //values read in a block before any definition in it, only these can need a phi
+        std::vector<ir::ir_value> non_local;
+        std::unordered_set<ir::ir_value> non_local_set;
+        std::unordered_map<ir::ir_value, std::vector<int> > definition_blocks;
+
+        const auto add_use = [&](const ir::ir_value& value, const std::unordered_set<ir::ir_value>& defined) {
+            if (value.is_constant() || defined.contains(value))
+                return;
+
+            if (non_local_set.insert(value).second)
+                non_local.push_back(value);
+        };
+
+        for (const auto& node : graph.nodes) {
+            if (node.removed || !dominators.contains(node.id))
+                continue;
+
+            std::unordered_set<ir::ir_value> defined;
+            for (const auto& instruction : node.instructions) {
+                for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot)
+                    add_use(instruction.operand(slot), defined);
+
+                if (instruction.opcode == ir::ir_opcode::Call) {
+                    for (const auto& argument : operands.arguments(instruction))
+                        add_use(argument, defined);
+                }
+
+                if (!instruction.has_result())
+                    continue;
+
+                //globals are shared with other functions, they keep one name and never get a phi
+                const auto result = instruction.result();
+                if (side_effects.is_global(result))
+                    continue;
+
+                defined.insert(result);
+                ++definition_counts[result];
+
+                auto& blocks = definition_blocks[result];
+                if (blocks.empty() || blocks.back() != node.id)
+                    blocks.push_back(node.id);
+            }
+        }
+
+        //stamps avoid clearing per value markers, indexed by block id + 1
+        std::vector<std::size_t> has_phi(phi_values.size(), 0);
+        std::vector<std::size_t> queued(phi_values.size(), 0);
+        std::size_t stamp = 0;
+
+        for (const auto& value : non_local) {
+            const auto it = definition_blocks.find(value);
+            if (it == definition_blocks.end() || definition_counts[value] < 2)
+                continue;
+
+            ++stamp;
+            std::vector<int> worklist = it->second;
+            for (const auto block : worklist)
+                queued[block + 1] = stamp;
+
+            while (!worklist.empty()) {
+                const auto block = worklist.back();
+                worklist.pop_back();
+
+                for (const auto frontier_block : dominators.frontier(block)) {
+                    if (frontier_block == EXIT || has_phi[frontier_block + 1] == stamp)
+                        continue;
+
+                    has_phi[frontier_block + 1] = stamp;
+                    insert_phi(graph.get_node_from_id(frontier_block), value, operands);
+                    ++definition_counts[value];
+
+                    if (queued[frontier_block + 1] != stamp) {
+                        queued[frontier_block + 1] = stamp;
+                        worklist.push_back(frontier_block);
+                    }
+                }
+            }
+        }
+    }
+
+    void SsaConstruction::insert_phi(NodeType& node, const ir::ir_value& value, ir::ir_operand_pool& operands) {
+        std::vector<ir::ir_value> incoming;
+        for (const auto predecessor : node.predecessors) {
+            incoming.push_back(value);
+            incoming.emplace_back(predecessor);
+        }
+
+        const auto offset = operands.append(incoming);
+        const auto phi = ir::make_phi(value, offset, static_cast<std::uint32_t>(node.predecessors.size()));
+
+        //after the label and the phis already there
+        auto position = node.instructions.begin();
+        while (position != node.instructions.end() && (position->opcode == ir::ir_opcode::Label || position->opcode == ir::ir_opcode::Phi))
+            ++position;
+
+        node.instructions.insert(position, phi);
+        phi_values[node.id + 1].push_back(value);
+        changes |= Changes::Inserted;
+    }
+
+    void SsaConstruction::rename(FlowGraphType& graph, ir::symbol_table& symbols, ir::ir_operand_pool& operands) {
+        const auto& dominators = graph.dominators();
+
+        //names pushed by a block are popped again when the walk leaves its subtree, like the resolver scopes
+        struct Frame {
+            int block;
+            std::size_t next_child;
+            std::size_t undo_mark;
+        };
+
+        std::vector<ir::ir_value> undo_log;
+        std::vector<Frame> stack;
+
+        const auto enter = [&](const int block) {
+            stack.push_back({block, 0, undo_log.size()});
+            auto& node = graph.get_node_from_id(block);
+            rename_block(node, symbols, operands, undo_log);
+            fill_phi_operands(node, graph, operands);
+        };
+
+        enter(dominators.get_root());
+        while (!stack.empty()) {
+            auto& frame = stack.back();
+            const auto& children = dominators.children(frame.block);
+
+            if (frame.next_child < children.size()) {
+                enter(children[frame.next_child++]);
+                continue;
+            }
+
+            while (undo_log.size() > frame.undo_mark) {
+                current_names[undo_log.back()].pop_back();
+                undo_log.pop_back();
+            }
+            stack.pop_back();
+        }
+    }
+
+    void SsaConstruction::rename_block(NodeType& node, ir::symbol_table& symbols, ir::ir_operand_pool& operands, std::vector<ir::ir_value>& undo_log) {
+        for (auto& instruction : node.instructions) {
+            if (instruction.opcode != ir::ir_opcode::Phi) {
+                for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot)
+                    instruction.set_operand(slot, current_name(instruction.operand(slot)));
+
+                if (instruction.opcode == ir::ir_opcode::Call) {
+                    for (auto& argument : operands.arguments(instruction))
+                        argument = current_name(argument);
+                }
+            }
+
+            if (instruction.has_result())
+                instruction.set_result(define(instruction.result(), symbols, undo_log));
+        }
+    }
+
+    void SsaConstruction::fill_phi_operands(const NodeType& node, FlowGraphType& graph, ir::ir_operand_pool& operands) {
+        for (const auto successor_id : node.successors) {
+            if (successor_id == EXIT)
+                continue;
+
+            const auto& successor = graph.get_node_from_id(successor_id);
+            const auto& originals = phi_values[successor_id + 1];
+            std::size_t phi_index = 0;
+
+            for (const auto& instruction : successor.instructions) {
+                if (instruction.opcode == ir::ir_opcode::Label)
+                    continue;
+
+                if (instruction.opcode != ir::ir_opcode::Phi)
+                    break;
+
+                auto incoming = operands.incoming(instruction);
+                for (std::size_t i = 0; i < incoming.size(); i += 2) {
+                    if (incoming[i + 1].get_constant() == node.id)
+                        incoming[i] = current_name(originals[phi_index]);
+                }
+                ++phi_index;
+            }
+        }
+    }
+
+    ir::ir_value SsaConstruction::define(const ir::ir_value& value, ir::symbol_table& symbols, std::vector<ir::ir_value>& undo_log) {
+        if (definition_counts[value] < 2)
+            return value;
+
+        const auto version = ++versions[value];
+        const auto name = ir::ir_value::variable(symbols.intern(symbols.value_to_string(value) + "." + std::to_string(version)));
+
+        current_names[value].push_back(name);
+        undo_log.push_back(value);
+        changes |= Changes::Rewritten;
+        return name;
+    }
+
+    ir::ir_value SsaConstruction::current_name(const ir::ir_value& value) const {
+        const auto it = current_names.find(value);
+        if (it == current_names.end() || it->second.empty())
+            return value;
+
+        return it->second.back();
+    }
+}
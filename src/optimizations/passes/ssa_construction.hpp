@@ -0,0 +1,51 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "flow_graph/flow_graph.hpp"
+#include "ir/ir.h"
+#include "ir/ir_function.h"
+#include "optimizations/analysis/side_effects.hpp"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Puts a function into SSA form: phis are placed on the iterated dominance frontier of every value that is defined
+    //more than once and read across blocks (semi-pruned), then definitions are renamed walking the dominator tree.
+    //Values with a single definition and globals keep their name, a use with no reaching definition keeps the original name
+    class SsaConstruction : public Pass {
+    public:
+        using FlowGraphType = FlowGraph<ir::ir_instruction>;
+        using NodeType = Node<ir::ir_instruction>;
+
+        [[nodiscard]] std::string_view name() const override {
+            return "ssa-construction";
+        }
+
+        [[nodiscard]] Analysis required_analyses() const override {
+            return Analysis::Dominators;
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
+
+    private:
+        //original value of every phi in the block, indexed by block id + 1
+        std::vector<std::vector<ir::ir_value> > phi_values;
+        std::unordered_map<ir::ir_value, int> definition_counts;
+        std::unordered_map<ir::ir_value, std::vector<ir::ir_value> > current_names;
+        std::unordered_map<ir::ir_value, std::uint32_t> versions;
+        Changes changes = Changes::None;
+
+        void place_phis(FlowGraphType& graph, ir::ir_operand_pool& operands, const SideEffects& side_effects);
+
+        void insert_phi(NodeType& node, const ir::ir_value& value, ir::ir_operand_pool& operands);
+
+        void rename(FlowGraphType& graph, ir::symbol_table& symbols, ir::ir_operand_pool& operands);
+
+        void rename_block(NodeType& node, ir::symbol_table& symbols, ir::ir_operand_pool& operands, std::vector<ir::ir_value>& undo_log);
+
+        void fill_phi_operands(const NodeType& node, FlowGraphType& graph, ir::ir_operand_pool& operands);
+
+        ir::ir_value define(const ir::ir_value& value, ir::symbol_table& symbols, std::vector<ir::ir_value>& undo_log);
+
+        ir::ir_value current_name(const ir::ir_value& value) const;
+    };
+}
@@ -0,0 +1,192 @@
+#include "ssa_destruction.hpp"
+
+#include <algorithm>
+
+namespace compiler {
+    Changes SsaDestruction::apply(ir::ir_function& function, PassContext& context) {
+        auto& graph = function.graph;
+        auto& symbols = context.program.symbols;
+        const auto& operands = context.program.operands;
+        split_edges = false;
+
+        std::vector<int> phi_blocks;
+        for (const auto& node : graph.nodes) {
+            if (!node.removed && std::ranges::any_of(node.instructions, [](const ir::ir_instruction& instruction) {
+                return instruction.opcode == ir::ir_opcode::Phi;
+            }))
+                phi_blocks.push_back(node.id);
+        }
+
+        for (const auto block_id : phi_blocks) {
+            std::vector<ir::ir_instruction> phis;
+            std::vector<int> predecessors;
+            {
+                auto& block = graph.get_node_from_id(block_id);
+                std::ranges::copy_if(block.instructions, std::back_inserter(phis), [](const ir::ir_instruction& instruction) {
+                    return instruction.opcode == ir::ir_opcode::Phi;
+                });
+                std::erase_if(block.instructions, [](const ir::ir_instruction& instruction) {
+                    return instruction.opcode == ir::ir_opcode::Phi;
+                });
+
+                for (const auto predecessor : block.predecessors) {
+                    if (!std::ranges::contains(predecessors, predecessor))
+                        predecessors.push_back(predecessor);
+                }
+            }
+
+            //the block falling through into this one goes first, splitting a jump edge may need to end that fallthrough
+            const auto fallthrough = graph.layout_predecessor(block_id);
+            std::ranges::stable_partition(predecessors, [fallthrough](const int predecessor) {
+                return predecessor == fallthrough;
+            });
+
+            for (const auto predecessor : predecessors) {
+                std::vector<ParallelCopy> copies;
+                for (const auto& phi : phis) {
+                    const auto incoming = operands.incoming(phi);
+                    for (std::size_t i = 0; i < incoming.size(); i += 2) {
+                        if (incoming[i + 1].get_constant() == predecessor) {
+                            copies.push_back({phi.result(), incoming[i]});
+                            break;
+                        }
+                    }
+                }
+
+                auto sequence = sequentialize(std::move(copies), symbols);
+                if (!sequence.empty())
+                    place_copies(function, predecessor, block_id, std::move(sequence));
+            }
+        }
+
+        if (phi_blocks.empty())
+            return Changes::None;
+
+        //phis are always removed, copies only when some incoming value differs from the phi
+        return Changes::Removed | Changes::Inserted | (split_edges ? Changes::Cfg : Changes::None);
+    }
+
+    std::vector<ir::ir_instruction> SsaDestruction::sequentialize(std::vector<ParallelCopy> copies, ir::symbol_table& symbols) {
+        std::vector<ir::ir_instruction> sequence;
+        std::erase_if(copies, [](const ParallelCopy& copy) {
+            return copy.destination == copy.source;
+        });
+
+        while (!copies.empty()) {
+            //a copy is safe once no other pending copy still reads its destination
+            const auto ready = std::ranges::find_if(copies, [&copies](const ParallelCopy& copy) {
+                return std::ranges::none_of(copies, [&copy](const ParallelCopy& other) {
+                    return other.source == copy.destination;
+                });
+            });
+
+            if (ready != copies.end()) {
+                sequence.push_back(ir::make_copy(ready->destination, ready->source));
+                copies.erase(ready);
+                continue;
+            }
+
+            //only cycles are left, save one destination so its copy becomes safe
+            const auto saved = copies.front().destination;
+            const auto swap = ir::ir_value::variable(symbols.intern("swap." + std::to_string(swap_counter++)));
+            sequence.push_back(ir::make_copy(swap, saved));
+
+            for (auto& copy : copies) {
+                if (copy.source == saved)
+                    copy.source = swap;
+            }
+        }
+
+        return sequence;
+    }
+
+    void SsaDestruction::place_copies(ir::ir_function& function, const int predecessor_id, const int block_id, std::vector<ir::ir_instruction> copies) {
+        auto& graph = function.graph;
+        auto& predecessor = graph.get_node_from_id(predecessor_id);
+
+        const bool only_successor = predecessor_id != ENTRY && std::ranges::all_of(predecessor.successors, [block_id](const int successor) {
+            return successor == block_id;
+        });
+
+        if (!only_successor) {
+            split_edge(function, predecessor_id, block_id, std::move(copies));
+            return;
+        }
+
+        auto& instructions = predecessor.instructions;
+        if (!instructions.empty() && instructions.back().is_conditional_jump()) {
+            //both edges lead to the block, drop the condition since the copies could overwrite it
+            instructions.back() = ir::make_jump(instructions.back().label());
+            graph.remove_edge(predecessor_id, block_id);
+            graph.add_edge(predecessor_id, block_id);
+            split_edges = true;
+        }
+
+        auto position = instructions.end();
+        if (!instructions.empty() && instructions.back().opcode == ir::ir_opcode::Jump)
+            --position;
+
+        instructions.insert(position, copies.begin(), copies.end());
+    }
+
+    void SsaDestruction::split_edge(ir::ir_function& function, const int predecessor_id, const int block_id, std::vector<ir::ir_instruction> copies) {
+        auto& graph = function.graph;
+        const auto& block = graph.get_node_from_id(block_id);
+        const auto& predecessor = graph.get_node_from_id(predecessor_id);
+
+        const bool block_has_label = !block.instructions.empty() && block.instructions.front().opcode == ir::ir_opcode::Label;
+        const auto block_label = block_has_label ? block.instructions.front().label() : 0;
+        const bool jump_edge = block_has_label && !predecessor.instructions.empty() && predecessor.instructions.back().is_jump()
+                               && predecessor.instructions.back().label() == block_label;
+
+        int split_id;
+        if (jump_edge) {
+            //the new block can not be fallen into, it is only reached by the retargeted jump
+            const auto split_label = function.create_label(ir::ir_label_kind::Split);
+            stop_fallthrough(graph, block_id);
+
+            copies.insert(copies.begin(), ir::make_label(split_label));
+            copies.push_back(ir::make_jump(block_label));
+            split_id = graph.add_node(std::move(copies), block_id);
+            graph.get_node_from_id(predecessor_id).instructions.back().attribute = split_label;
+        } else {
+            //fallthrough edge, the new block goes between the two
+            if (block_has_label)
+                copies.push_back(ir::make_jump(block_label));
+            split_id = graph.add_node(std::move(copies), block_id);
+        }
+
+        graph.remove_edge(predecessor_id, block_id);
+        graph.add_edge(predecessor_id, split_id);
+        graph.add_edge(split_id, block_id);
+        split_edges = true;
+    }
+
+    void SsaDestruction::stop_fallthrough(FlowGraphType& graph, const int block_id) {
+        const auto previous_id = graph.layout_predecessor(block_id);
+        auto& previous = graph.get_node_from_id(previous_id);
+        const auto block_label = graph.get_node_from_id(block_id).instructions.front().label();
+
+        if (previous_id != ENTRY && !previous.instructions.empty()) {
+            const auto& last = previous.instructions.back();
+            if (last.opcode == ir::ir_opcode::Jump || last.opcode == ir::ir_opcode::Return)
+                return;
+        }
+
+        if (previous_id != ENTRY && (previous.instructions.empty() || !previous.instructions.back().is_conditional_jump())) {
+            previous.instructions.push_back(ir::make_jump(block_label));
+            return;
+        }
+
+        //ENTRY and conditional jumps can not take another jump, the fallthrough gets its own block
+        const auto stub_id = graph.add_node({ir::make_jump(block_label)}, block_id);
+        split_edges = true;
+        graph.remove_edge(previous_id, block_id);
+        graph.add_edge(previous_id, stub_id);
+        graph.add_edge(stub_id, block_id);
+
+        const auto& jump_source = graph.get_node_from_id(previous_id);
+        if (previous_id != ENTRY && jump_source.instructions.back().label() == block_label)
+            graph.add_edge(previous_id, block_id);
+    }
+}
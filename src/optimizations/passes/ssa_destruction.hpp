@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include "flow_graph/flow_graph.hpp"
+#include "ir/ir.h"
+#include "ir/ir_function.h"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Takes a function out of SSA form before codegen. The phis of a block become one parallel copy per predecessor,
+    //sequentialized with a swap value when the copies form a cycle. Copies go at the end of the predecessor when
+    //it only flows into the block, otherwise the edge is split with a new block
+    class SsaDestruction : public Pass {
+    public:
+        using FlowGraphType = FlowGraph<ir::ir_instruction>;
+        using NodeType = Node<ir::ir_instruction>;
+
+        [[nodiscard]] std::string_view name() const override {
+            return "ssa-destruction";
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
+
+    private:
+        struct ParallelCopy {
+            ir::ir_value destination;
+            ir::ir_value source;
+        };
+
+        std::uint32_t swap_counter = 0;
+        bool split_edges = false;
+
+        std::vector<ir::ir_instruction> sequentialize(std::vector<ParallelCopy> copies, ir::symbol_table& symbols);
+
+        void place_copies(ir::ir_function& function, int predecessor_id, int block_id, std::vector<ir::ir_instruction> copies);
+
+        void split_edge(ir::ir_function& function, int predecessor_id, int block_id, std::vector<ir::ir_instruction> copies);
+
+        void stop_fallthrough(FlowGraphType& graph, int block_id);
+    };
+}
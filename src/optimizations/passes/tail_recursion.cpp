@@ -0,0 +1,88 @@
+#include "tail_recursion.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes TailRecursion::apply(ir::ir_function& function, PassContext& context) {
+        auto& program = context.program;
+        auto& graph = function.graph;
+
+        //top level code shares the name, a call to entry is never a call to the same chunk
+        if (program.symbols.name(function.name) == "entry")
+            return Changes::None;
+
+        std::vector<std::pair<int, std::size_t> > tail_calls;
+        for (const auto& node : graph.nodes) {
+            if (node.removed)
+                continue;
+
+            if (const auto position = find_tail_call(node, function, context.analyses.side_effects()))
+                tail_calls.emplace_back(node.id, *position);
+        }
+
+        if (tail_calls.empty())
+            return Changes::None;
+
+        //the first block can already be a loop header, the calls get a block of their own to jump to
+        const auto first = graph.get_node_from_id(ENTRY).successors.front();
+        const auto label = function.create_label(ir::ir_label_kind::TailEntry);
+        const auto start = graph.add_node({ir::make_label(label)}, first);
+        graph.remove_edge(ENTRY, first);
+        graph.add_edge(ENTRY, start);
+        graph.add_edge(start, first);
+
+        for (const auto& [block_id, position] : tail_calls) {
+            auto& instructions = graph.get_node_from_id(block_id).instructions;
+            const auto arguments = program.operands.arguments(instructions[position]);
+
+            //an argument that is a parameter has to be read before the parameters are assigned
+            std::vector<ir::ir_instruction> saved;
+            std::vector<ir::ir_instruction> assigned;
+            for (std::size_t i = 0; i < arguments.size(); ++i) {
+                auto value = arguments[i];
+                if (std::ranges::contains(function.parameters, value)) {
+                    const auto temporary = program.make_temporary();
+                    saved.push_back(ir::make_copy(temporary, value));
+                    value = temporary;
+                }
+                assigned.push_back(ir::make_copy(function.parameters[i], value));
+            }
+
+            instructions.resize(position);
+            instructions.insert(instructions.end(), saved.begin(), saved.end());
+            instructions.insert(instructions.end(), assigned.begin(), assigned.end());
+            instructions.push_back(ir::make_jump(label));
+
+            graph.remove_edge(block_id, EXIT);
+            graph.add_edge(block_id, start);
+        }
+
+        return Changes::Cfg | Changes::Inserted | Changes::Removed;
+    }
+
+    std::optional<std::size_t> TailRecursion::find_tail_call(const NodeType& node, const ir::ir_function& function, const SideEffects& side_effects) {
+        const auto& instructions = node.instructions;
+        if (instructions.empty() || instructions.back().opcode != ir::ir_opcode::Return)
+            return {};
+
+        //walks back through the copies handing the call result to the return, a global among them is a visible store
+        auto value = instructions.back().source();
+        for (auto position = instructions.size() - 1; position-- > 0;) {
+            const auto& instruction = instructions[position];
+            if (instruction.opcode == ir::ir_opcode::Copy && instruction.result() == value && !side_effects.is_global(value)) {
+                value = instruction.source();
+                continue;
+            }
+
+            if (instruction.opcode == ir::ir_opcode::Call && instruction.result() == value && instruction.callee() == function.name
+                && instruction.argument_count() == function.parameters.size())
+                return position;
+
+            return {};
+        }
+        return {};
+    }
+}
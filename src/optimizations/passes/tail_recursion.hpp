@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include "flow_graph/flow_graph.hpp"
+#include "ir/ir.h"
+#include "ir/ir_function.h"
+#include "optimizations/analysis/side_effects.hpp"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Turns calls of a function to itself whose result is returned right away into a loop. The arguments are copied
+    //into the parameters and the call jumps back to a label in front of the first block, so deep recursion runs
+    //in one frame. Runs before SSA construction, the parameters are assigned like any other variable
+    class TailRecursion : public Pass {
+    public:
+        using NodeType = Node<ir::ir_instruction>;
+
+        [[nodiscard]] std::string_view name() const override {
+            return "tail-recursion";
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
+
+    private:
+        //position of the call in the block when the block ends by returning its result, copies in between included
+        static std::optional<std::size_t> find_tail_call(const NodeType& node, const ir::ir_function& function, const SideEffects& side_effects);
+    };
+}
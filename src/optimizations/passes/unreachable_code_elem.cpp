@@ -4,35 +4,47 @@
 #include "flow_graph/flow_graph.hpp"
 
 namespace compiler {
-    bool UnreachableCode::apply(FlowGraphType& flow_graph) {
-        bool changed = false;
+    Changes UnreachableCode::apply(ir::ir_function& function, PassContext&) {
+        Changes changes = Changes::None;
 
-        changed |= remove_unreachable_blocks(flow_graph);
-        changed |= remove_redundant_jumps(flow_graph);
-        changed |= remove_redundant_labels(flow_graph);
+        if (remove_unreachable_blocks(function.graph))
+            changes |= Changes::Cfg | Changes::Removed;
 
-        return changed;
+        if (remove_redundant_jumps(function.graph))
+            changes |= Changes::Removed;
+
+        if (remove_redundant_labels(function.graph))
+            changes |= Changes::Removed;
+
+        return changes;
     }
 
     bool UnreachableCode::holds_any_jump(const ir::ir_instruction& instruction) {
-        return std::holds_alternative<ir::ir_jump>(instruction)
-               || std::holds_alternative<ir::ir_jump_if_zero>(instruction)
-               || std::holds_alternative<ir::ir_jump_if_not_zero>(instruction);
+        return instruction.is_jump();
     }
 
     bool UnreachableCode::remove_unreachable_blocks(FlowGraphType& flow_graph) {
         bool changed = false;
 
-        for (auto& node : flow_graph.nodes) {
-            if (node.id == ENTRY || node.id == EXIT)
+        //collected first, removing a node drops the cached order
+        std::vector<int> unreachable;
+        for (const auto& node : flow_graph.nodes) {
+            if (node.id == ENTRY || node.id == EXIT || node.removed)
                 continue;
 
-            if (node.predecessors.empty()) {
-                flow_graph.remove_node(node);
-                changed = true;
-            }
+            if (flow_graph.rpo_number(node.id) == INVALID)
+                unreachable.push_back(node.id);
+        }
+
+        for (const auto id : unreachable) {
+            flow_graph.remove_node(id);
+            changed = true;
         }
 
+        //the other two steps look at layout neighbours, so drop the tombstones now
+        if (changed)
+            flow_graph.compact();
+
         return changed;
     }
 
@@ -49,7 +61,7 @@ namespace compiler {
             auto last_instruction = node.instructions.back();
 
             if (holds_any_jump(last_instruction)) {
-                auto default_successor = flow_graph.nodes[index + 1];
+                const auto& default_successor = flow_graph.nodes[index + 1];
 
                 bool has_non_default_successor = std::ranges::any_of(node.successors, [&](auto successor_id) -> bool {
                                                                          return successor_id != default_successor.id;
@@ -78,10 +90,10 @@ namespace compiler {
 
             auto first_instruction = node.instructions.front();
 
-            if (std::holds_alternative<ir::ir_label>(first_instruction)) {
-                auto predecessors = flow_graph.nodes[index - 1];
+            if (first_instruction.opcode == ir::ir_opcode::Label) {
+                const auto& previous = flow_graph.nodes[index - 1];
 
-                if (node.predecessors.size() == 1 && node.predecessors[0] == predecessors.id) {
+                if (node.predecessors.size() == 1 && node.predecessors[0] == previous.id) {
                     node.instructions.erase(node.instructions.begin());
                     changed = true;
                 }
@@ -1,12 +1,21 @@
 #pragma once
 #include "flow_graph/flow_graph.hpp"
+#include "optimizations/pass.hpp"
 
 namespace compiler {
-    class UnreachableCode {
+    class UnreachableCode : public Pass {
     public:
         using FlowGraphType = FlowGraph<ir::ir_instruction>;
 
-        bool apply(FlowGraphType& flow_graph);
+        [[nodiscard]] std::string_view name() const override {
+            return "unreachable-code";
+        }
+
+        [[nodiscard]] Analysis required_analyses() const override {
+            return Analysis::Cfg;
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
 
     private:
         bool holds_any_jump(const ir::ir_instruction& instruction);
@@ -0,0 +1,141 @@
+#include "value_numbering.hpp"
+
+#include "optimizations/pass_manager.hpp"
+
+namespace compiler {
+    Changes GlobalValueNumbering::apply(ir::ir_function& function, PassContext& context) {
+        auto& graph = function.graph;
+        const auto& dominators = graph.dominators();
+        side_effects = &context.analyses.side_effects();
+        count_definitions(graph);
+        leaders.clear();
+        available.clear();
+
+        //expressions of a block stay available in the blocks it dominates, they are dropped when the walk leaves it
+        struct Frame {
+            int block;
+            std::size_t next_child;
+            std::size_t undo_mark;
+        };
+
+        std::vector<Expression> undo_log;
+        std::vector<Frame> stack;
+        bool changed = false;
+
+        const auto enter = [&](const int block) {
+            stack.push_back({block, 0, undo_log.size()});
+            changed |= number_block(graph.get_node_from_id(block), undo_log);
+        };
+
+        enter(dominators.get_root());
+        while (!stack.empty()) {
+            auto& frame = stack.back();
+            const auto& children = dominators.children(frame.block);
+
+            if (frame.next_child < children.size()) {
+                enter(children[frame.next_child++]);
+                continue;
+            }
+
+            while (undo_log.size() > frame.undo_mark) {
+                available.erase(undo_log.back());
+                undo_log.pop_back();
+            }
+            stack.pop_back();
+        }
+
+        return changed ? Changes::Rewritten : Changes::None;
+    }
+
+    void GlobalValueNumbering::count_definitions(const FlowGraphType& graph) {
+        definition_counts.clear();
+
+        for (const auto& node : graph.nodes) {
+            for (const auto& instruction : node.instructions) {
+                if (instruction.has_result())
+                    ++definition_counts[instruction.result()];
+            }
+        }
+    }
+
+    bool GlobalValueNumbering::number_block(NodeType& node, std::vector<Expression>& undo_log) {
+        bool changed = false;
+
+        for (auto& instruction : node.instructions) {
+            if (instruction.opcode == ir::ir_opcode::Copy) {
+                if (is_stable(instruction.result()) && is_stable(instruction.source()))
+                    leaders[instruction.result()] = leader(instruction.source());
+                continue;
+            }
+
+            const auto expression = expression_of(instruction);
+            if (!expression.has_value())
+                continue;
+
+            const auto result = instruction.result();
+            if (const auto it = available.find(*expression); it != available.end()) {
+                instruction = ir::make_copy(result, it->second);
+                if (is_stable(result))
+                    leaders[result] = it->second;
+                changed = true;
+                continue;
+            }
+
+            if (is_stable(result)) {
+                available.emplace(*expression, result);
+                undo_log.push_back(*expression);
+            }
+        }
+
+        return changed;
+    }
+
+    bool GlobalValueNumbering::is_stable(const ir::ir_value& value) const {
+        if (value.is_constant())
+            return true;
+
+        //calls can write globals, so they are not stable even when this function never assigns them
+        if (side_effects->is_global(value))
+            return false;
+
+        const auto it = definition_counts.find(value);
+        return it == definition_counts.end() || it->second == 1;
+    }
+
+    ir::ir_value GlobalValueNumbering::leader(const ir::ir_value& value) const {
+        const auto it = leaders.find(value);
+        return it == leaders.end() ? value : it->second;
+    }
+
+    std::optional<GlobalValueNumbering::Expression> GlobalValueNumbering::expression_of(const ir::ir_instruction& instruction) const {
+        if (instruction.opcode != ir::ir_opcode::Binary && instruction.opcode != ir::ir_opcode::Unary)
+            return {};
+
+        for (std::size_t slot = 1; slot <= instruction.source_count(); ++slot) {
+            if (!is_stable(instruction.operand(slot)))
+                return {};
+        }
+
+        auto left = leader(instruction.left()).raw();
+        auto right = instruction.opcode == ir::ir_opcode::Binary ? leader(instruction.right()).raw() : 0;
+        if (instruction.opcode == ir::ir_opcode::Binary && is_commutative(instruction.op()) && right < left)
+            std::swap(left, right);
+
+        return Expression{instruction.opcode, instruction.attribute, left, right};
+    }
+
+    bool GlobalValueNumbering::is_commutative(const token_type op) {
+        switch (op) {
+        case token_type::Plus:
+        case token_type::Star:
+        case token_type::EqualEqual:
+        case token_type::NotEqual:
+        case token_type::Ampersand:
+        case token_type::Pipe:
+        case token_type::Caret:
+            return true;
+        default:
+            return false;
+        }
+    }
+}
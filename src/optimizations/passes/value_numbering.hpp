@@ -0,0 +1,67 @@
+#pragma once
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "flow_graph/flow_graph.hpp"
+#include "ir/ir.h"
+#include "lexer/token.h"
+#include "optimizations/analysis/side_effects.hpp"
+#include "optimizations/pass.hpp"
+
+namespace compiler {
+    //Dominator scoped value numbering. Copies share the number of their source, a binary or unary expression over
+    //numbers already computed in a dominating block becomes a copy of the earlier result, copy propagation and dead
+    //code elimination clean it up. Only values with a single definition that are not globals are numbered, anything
+    //that can be redefined (globals, variables out of SSA form) never takes part in an expression
+    class GlobalValueNumbering : public Pass {
+    public:
+        using FlowGraphType = FlowGraph<ir::ir_instruction>;
+        using NodeType = Node<ir::ir_instruction>;
+
+        [[nodiscard]] std::string_view name() const override {
+            return "value-numbering";
+        }
+
+        [[nodiscard]] Analysis required_analyses() const override {
+            return Analysis::Dominators;
+        }
+
+        Changes apply(ir::ir_function& function, PassContext& context) override;
+
+    private:
+        struct Expression {
+            ir::ir_opcode opcode;
+            std::uint32_t op;
+            std::uint64_t left;
+            std::uint64_t right;
+
+            bool operator==(const Expression& other) const = default;
+        };
+
+        struct ExpressionHash {
+            std::size_t operator()(const Expression& expression) const noexcept {
+                auto hash = std::hash<std::uint64_t>()(expression.left);
+                hash = hash * 31 + std::hash<std::uint64_t>()(expression.right);
+                return hash * 31 + (static_cast<std::size_t>(expression.opcode) << 16 | expression.op);
+            }
+        };
+
+        const SideEffects* side_effects = nullptr;
+        std::unordered_map<ir::ir_value, int> definition_counts;
+        //the value a stable value is known to be equal to, missing when it is its own number
+        std::unordered_map<ir::ir_value, ir::ir_value> leaders;
+        std::unordered_map<Expression, ir::ir_value, ExpressionHash> available;
+
+        void count_definitions(const FlowGraphType& graph);
+
+        bool number_block(NodeType& node, std::vector<Expression>& undo_log);
+
+        [[nodiscard]] bool is_stable(const ir::ir_value& value) const;
+
+        [[nodiscard]] ir::ir_value leader(const ir::ir_value& value) const;
+
+        [[nodiscard]] std::optional<Expression> expression_of(const ir::ir_instruction& instruction) const;
+
+        static bool is_commutative(token_type op);
+    };
+}
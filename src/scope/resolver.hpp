@@ -1,6 +1,5 @@
 #pragma once
 #include <optional>
-#include <ranges>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -8,34 +7,59 @@
 class Resolver {
 public:
     int count = 0;
-    std::vector<std::unordered_map<std::string, int> > scopes;
 
     Resolver() {
         begin_scope();
     }
 
     void begin_scope() {
-        scopes.emplace_back();
+        scope_marks.push_back(undo_log.size());
     }
 
     void end_scope() {
-        scopes.pop_back();
+        const auto mark = scope_marks.back();
+        scope_marks.pop_back();
+
+        //unordered_map never moves its values, so the log can point straight at the binding stacks
+        while (undo_log.size() > mark) {
+            undo_log.back()->pop_back();
+            undo_log.pop_back();
+        }
     }
 
     std::optional<int> declare(const std::string& name) {
-        if (scopes.empty())
+        if (scope_marks.empty())
             return {};
 
-        scopes.back()[name] = ++count;
+        const auto depth = scope_marks.size();
+        auto& bindings = symbols[name];
+
+        //redeclaration in the same scope shadows the previous one without a new undo entry
+        if (!bindings.empty() && bindings.back().depth == depth) {
+            bindings.back().id = ++count;
+            return count;
+        }
+
+        bindings.push_back({depth, ++count});
+        undo_log.push_back(&bindings);
         return count;
     }
 
-    std::optional<int> resolve(const std::string& name) {
-        for (const auto& scope : std::views::reverse(scopes)) {
-            if (scope.contains(name)) {
-                return scope.at(name);
-            }
-        }
-        return {};
+    std::optional<int> resolve(const std::string& name) const {
+        const auto it = symbols.find(name);
+        if (it == symbols.end() || it->second.empty())
+            return {};
+
+        return it->second.back().id;
     }
+
+private:
+    struct Binding {
+        std::size_t depth;
+        int id;
+    };
+
+    std::unordered_map<std::string, std::vector<Binding> > symbols;
+    std::vector<std::vector<Binding>*> undo_log;
+    std::vector<std::size_t> scope_marks;
 };
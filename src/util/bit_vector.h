@@ -0,0 +1,122 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace util {
+    //Dense fixed size bitset for dataflow sets. The set operations are plain loops over 64 bit words so the compiler can vectorize them
+    class bit_vector {
+    public:
+        bit_vector() = default;
+
+        explicit bit_vector(const std::size_t size, const bool value = false)
+            : words(word_count(size), value ? ~std::uint64_t{0} : 0),
+              bits(size) {
+            clear_padding();
+        }
+
+        [[nodiscard]] std::size_t size() const {
+            return bits;
+        }
+
+        [[nodiscard]] bool test(const std::size_t index) const {
+            return words[index / 64] >> (index % 64) & 1;
+        }
+
+        void set(const std::size_t index) {
+            words[index / 64] |= std::uint64_t{1} << (index % 64);
+        }
+
+        void reset(const std::size_t index) {
+            words[index / 64] &= ~(std::uint64_t{1} << (index % 64));
+        }
+
+        void set_all() {
+            for (auto& word : words)
+                word = ~std::uint64_t{0};
+            clear_padding();
+        }
+
+        void reset_all() {
+            for (auto& word : words)
+                word = 0;
+        }
+
+        [[nodiscard]] bool none() const {
+            for (const auto word : words)
+                if (word != 0)
+                    return false;
+            return true;
+        }
+
+        [[nodiscard]] std::size_t count() const {
+            std::size_t result = 0;
+            for (const auto word : words)
+                result += static_cast<std::size_t>(std::popcount(word));
+            return result;
+        }
+
+        bit_vector& operator|=(const bit_vector& other) {
+            for (std::size_t i = 0; i < words.size(); ++i)
+                words[i] |= other.words[i];
+            return *this;
+        }
+
+        bit_vector& operator&=(const bit_vector& other) {
+            for (std::size_t i = 0; i < words.size(); ++i)
+                words[i] &= other.words[i];
+            return *this;
+        }
+
+        //this &= ~other
+        bit_vector& subtract(const bit_vector& other) {
+            for (std::size_t i = 0; i < words.size(); ++i)
+                words[i] &= ~other.words[i];
+            return *this;
+        }
+
+        //index of the first set bit at or after from, size() if there is none
+        [[nodiscard]] std::size_t find_next(const std::size_t from) const {
+            if (from >= bits)
+                return bits;
+
+            auto i = from / 64;
+            auto word = words[i] & ~std::uint64_t{0} << (from % 64);
+            while (word == 0) {
+                if (++i == words.size())
+                    return bits;
+                word = words[i];
+            }
+            return i * 64 + static_cast<std::size_t>(std::countr_zero(word));
+        }
+
+        //calls f with the index of every set bit, in increasing order
+        template <typename F>
+        void for_each(F&& f) const {
+            for (std::size_t i = 0; i < words.size(); ++i) {
+                auto word = words[i];
+                while (word != 0) {
+                    f(i * 64 + static_cast<std::size_t>(std::countr_zero(word)));
+                    word &= word - 1;
+                }
+            }
+        }
+
+        bool operator==(const bit_vector& other) const = default;
+
+    private:
+        std::vector<std::uint64_t> words;
+        std::size_t bits = 0;
+
+        static std::size_t word_count(const std::size_t size) {
+            return (size + 63) / 64;
+        }
+
+        //bits past size stay zero so == and count work on whole words
+        void clear_padding() {
+            if (bits % 64 != 0)
+                words.back() &= (std::uint64_t{1} << (bits % 64)) - 1;
+        }
+    };
+}
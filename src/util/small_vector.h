@@ -0,0 +1,173 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+
+namespace util {
+    //Vector that keeps the first N elements inline and only touches the heap past that.
+    //Restricted to trivially copyable types, it is meant for ids and handles
+    template <typename T, std::size_t N>
+    class small_vector {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        small_vector() = default;
+
+        small_vector(std::initializer_list<T> init) {
+            for (const auto& value : init)
+                push_back(value);
+        }
+
+        small_vector(const small_vector& other) {
+            for (const auto& value : other)
+                push_back(value);
+        }
+
+        small_vector(small_vector&& other) noexcept {
+            take(other);
+        }
+
+        small_vector& operator=(const small_vector& other) {
+            if (this != &other) {
+                clear();
+                for (const auto& value : other)
+                    push_back(value);
+            }
+            return *this;
+        }
+
+        small_vector& operator=(small_vector&& other) noexcept {
+            if (this != &other) {
+                heap.reset();
+                take(other);
+            }
+            return *this;
+        }
+
+        void push_back(const T& value) {
+            if (count == capacity)
+                grow(capacity * 2);
+
+            data()[count++] = value;
+        }
+
+        void pop_back() {
+            --count;
+        }
+
+        void clear() {
+            count = 0;
+        }
+
+        iterator erase(iterator first, iterator last) {
+            const auto moved_end = std::copy(last, end(), first);
+            count = static_cast<size_type>(moved_end - begin());
+            return first;
+        }
+
+        iterator erase(iterator position) {
+            return erase(position, position + 1);
+        }
+
+        [[nodiscard]] T* data() {
+            return heap ? heap.get() : inline_storage.data();
+        }
+
+        [[nodiscard]] const T* data() const {
+            return heap ? heap.get() : inline_storage.data();
+        }
+
+        [[nodiscard]] size_type size() const {
+            return count;
+        }
+
+        [[nodiscard]] bool empty() const {
+            return count == 0;
+        }
+
+        T& operator[](const size_type index) {
+            return data()[index];
+        }
+
+        const T& operator[](const size_type index) const {
+            return data()[index];
+        }
+
+        T& front() {
+            return data()[0];
+        }
+
+        const T& front() const {
+            return data()[0];
+        }
+
+        T& back() {
+            return data()[count - 1];
+        }
+
+        const T& back() const {
+            return data()[count - 1];
+        }
+
+        iterator begin() {
+            return data();
+        }
+
+        iterator end() {
+            return data() + count;
+        }
+
+        const_iterator begin() const {
+            return data();
+        }
+
+        const_iterator end() const {
+            return data() + count;
+        }
+
+        friend bool operator==(const small_vector& lhs, const small_vector& rhs) {
+            return std::ranges::equal(lhs, rhs);
+        }
+
+    private:
+        std::array<T, N> inline_storage{};
+        std::unique_ptr<T[]> heap;
+        size_type count = 0;
+        size_type capacity = N;
+
+        void grow(const size_type new_capacity) {
+            auto new_storage = std::make_unique<T[]>(new_capacity);
+            std::copy(begin(), end(), new_storage.get());
+            heap = std::move(new_storage);
+            capacity = new_capacity;
+        }
+
+        void take(small_vector& other) {
+            count = other.count;
+            if (other.heap) {
+                heap = std::move(other.heap);
+                capacity = other.capacity;
+            } else {
+                std::copy(other.begin(), other.end(), inline_storage.begin());
+                capacity = N;
+            }
+            other.count = 0;
+            other.capacity = N;
+        }
+    };
+
+    template <typename T, std::size_t N, typename U>
+    std::size_t erase(small_vector<T, N>& vector, const U& value) {
+        const auto old_size = vector.size();
+        vector.erase(std::remove(vector.begin(), vector.end(), value), vector.end());
+        return old_size - vector.size();
+    }
+}
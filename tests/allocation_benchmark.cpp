@@ -0,0 +1,122 @@
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+#include "test_support.hpp"
+#include "optimizations/optimizer.hpp"
+
+//Counts heap allocations while the optimizer runs. Blocks move into the graph and stay there, passes change them
+//in place, so a fixpoint round costs the driver no allocation at all
+
+namespace {
+    std::size_t allocations = 0;
+
+    //reports a change for a fixed number of rounds and touches nothing, so only the driver is measured
+    class Spin : public compiler::Pass {
+    public:
+        explicit Spin(const int rounds)
+            : rounds(rounds) {}
+
+        [[nodiscard]] std::string_view name() const override {
+            return "spin";
+        }
+
+        compiler::Changes apply(compiler::ir::ir_function&, compiler::PassContext&) override {
+            return rounds-- > 0 ? compiler::Changes::Rewritten : compiler::Changes::None;
+        }
+
+    private:
+        int rounds;
+    };
+
+    const std::string source = R"(
+int sum(int n) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        if (i > 3) {
+            s = s + i * 4;
+        } else {
+            s = s - 1;
+        }
+        i = i + 1;
+    }
+    return s;
+}
+
+int main() {
+    int a = sum(10);
+    int b = sum(a);
+    return a + b;
+}
+)";
+
+    //allocations made by a fixpoint group that runs the given number of rounds over the function sum
+    std::size_t driver_allocations(const int rounds) {
+        auto program = compiler::tests::generate(source);
+        std::vector<std::unique_ptr<compiler::Pass> > passes;
+        passes.push_back(std::make_unique<Spin>(rounds));
+
+        compiler::PassManager pipeline;
+        pipeline.add_fixpoint(std::move(passes), rounds + 1);
+
+        const auto before = allocations;
+        pipeline.run(program.functions.front(), program);
+        return allocations - before;
+    }
+}
+
+void* operator new(const std::size_t size) {
+    ++allocations;
+    if (void* memory = std::malloc(size == 0 ? 1 : size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+int main() {
+    using compiler::tests::check;
+
+    //the rounds themselves allocate nothing, a hundred cost the same as one
+    const auto one_round = driver_allocations(1);
+    const auto hundred_rounds = driver_allocations(100);
+    std::println("fixpoint driver: {} allocations for 1 round, {} for 100 rounds", one_round, hundred_rounds);
+    check(one_round == hundred_rounds, "fixpoint rounds allocate");
+
+    //blocks handed to the graph keep their buffers
+    auto program = compiler::tests::generate(source);
+    auto& graph = program.functions.front().graph;
+    auto code = graph.release_instructions();
+    const auto size = code.size();
+    const auto* data = code.data();
+    std::vector<std::vector<compiler::ir::ir_instruction> > blocks;
+    blocks.push_back(std::move(code));
+    graph.generate_flowgraph(std::move(blocks));
+    check(graph.nodes[1].instructions.data() == data, "block copied into the graph");
+
+    const auto released = graph.release_instructions();
+    check(released.size() == size, "instructions lost on the way out of the graph");
+
+    //the whole default pipeline, for reference
+    program = compiler::tests::generate(source);
+    compiler::Optimizer optimizer;
+    const auto before = allocations;
+    const auto start = std::chrono::steady_clock::now();
+    optimizer.optimize(program);
+    const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start);
+
+    int iterations = 0;
+    for (const auto& metrics : optimizer.metrics())
+        iterations += metrics.iterations;
+    std::println("default pipeline: {} allocations, {} fixpoint rounds, {:.0f}us", allocations - before, iterations, elapsed.count());
+
+    return compiler::tests::failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
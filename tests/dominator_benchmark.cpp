@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "test_support.hpp"
+#include "flow_graph/flow_graph.hpp"
+#include "util/bit_vector.h"
+
+//Checks the dominator and post-dominator trees and their frontiers against a naive set based computation on
+//random CFGs, then times building them on 10k block CFGs
+
+namespace {
+    using Graph = compiler::FlowGraph<compiler::ir::ir_instruction>;
+    using compiler::tests::check;
+
+    std::size_t slot(const int id) {
+        return static_cast<std::size_t>(id + 1);
+    }
+
+    //loops close with a conditional jump back, ifs jump forwards, a few blocks return or fall through
+    Graph random_graph(const int blocks, const unsigned seed) {
+        std::mt19937 random(seed);
+        const auto target = [&](const int block, const bool backwards) {
+            const int distance = static_cast<int>(random() % 20) + 1;
+            return static_cast<std::uint32_t>(std::clamp(backwards ? block - distance : block + distance, 0, blocks - 1));
+        };
+
+        const auto condition = compiler::ir::ir_value::temporary(0);
+        std::vector<compiler::ir::ir_instruction> code;
+        for (int block = 0; block < blocks; ++block) {
+            code.push_back(compiler::ir::make_label(static_cast<std::uint32_t>(block)));
+            code.push_back(compiler::ir::make_copy(condition, compiler::ir::ir_value{block}));
+
+            const auto kind = random() % 100;
+            if (kind == 0)
+                code.push_back(compiler::ir::make_return(condition));
+            else if (kind < 15)
+                code.push_back(compiler::ir::make_jump(target(block, false)));
+            else if (kind < 90)
+                code.push_back(compiler::ir::make_jump_if_zero(condition, target(block, random() % 3 == 0)));
+        }
+
+        Graph graph;
+        graph.generate_flowgraph(std::move(code));
+        return graph;
+    }
+
+    //edges by slot, in the direction the tree is built in
+    struct Edges {
+        std::vector<std::vector<int> > incoming;
+        std::vector<std::vector<int> > outgoing;
+    };
+
+    Edges edges_of(const Graph& graph, const bool forward) {
+        Edges edges{std::vector<std::vector<int> >(slot(graph.max_node_id()) + 1), std::vector<std::vector<int> >(slot(graph.max_node_id()) + 1)};
+        for (const auto& node : graph.nodes) {
+            for (const int successor : node.successors) {
+                edges.outgoing[slot(forward ? node.id : successor)].push_back(forward ? successor : node.id);
+                edges.incoming[slot(forward ? successor : node.id)].push_back(forward ? node.id : successor);
+            }
+        }
+        return edges;
+    }
+
+    //a node's dominators are itself plus the dominators all of its reachable incoming neighbours share
+    std::vector<util::bit_vector> naive_dominators(const Edges& edges, const int root, std::vector<char>& reached) {
+        const auto slots = edges.incoming.size();
+        reached.assign(slots, 0);
+        std::vector worklist{root};
+        reached[slot(root)] = 1;
+        while (!worklist.empty()) {
+            const int node = worklist.back();
+            worklist.pop_back();
+            for (const int next : edges.outgoing[slot(node)]) {
+                if (!reached[slot(next)]) {
+                    reached[slot(next)] = 1;
+                    worklist.push_back(next);
+                }
+            }
+        }
+
+        std::vector dominators(slots, util::bit_vector(slots, true));
+        dominators[slot(root)] = util::bit_vector(slots);
+        dominators[slot(root)].set(slot(root));
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (std::size_t node = 0; node < slots; ++node) {
+                if (!reached[node] || node == slot(root))
+                    continue;
+
+                util::bit_vector shared(slots, true);
+                for (const int previous : edges.incoming[node]) {
+                    if (reached[slot(previous)])
+                        shared &= dominators[slot(previous)];
+                }
+                shared.set(node);
+
+                if (shared != dominators[node]) {
+                    dominators[node] = std::move(shared);
+                    changed = true;
+                }
+            }
+        }
+        return dominators;
+    }
+
+    void compare(const compiler::DominatorTree& tree, const Edges& edges, const int root, const std::string& what) {
+        std::vector<char> reached;
+        const auto dominators = naive_dominators(edges, root, reached);
+        const auto slots = dominators.size();
+        const auto id = [](const std::size_t node) {
+            return static_cast<int>(node) - 1;
+        };
+
+        for (std::size_t node = 0; node < slots; ++node) {
+            //messages are only built for a failure, the 10k block graph makes 10^8 checks
+            if (tree.contains(id(node)) != (reached[node] != 0))
+                check(false, what + ": reachable " + std::to_string(id(node)));
+            if (!reached[node])
+                continue;
+
+            for (std::size_t dominator = 0; dominator < slots; ++dominator) {
+                if (reached[dominator] && tree.dominates(id(dominator), id(node)) != dominators[node].test(dominator))
+                    check(false, what + ": " + std::to_string(id(dominator)) + " dominates " + std::to_string(id(node)));
+            }
+
+            //the frontier of a node holds the blocks it reaches without strictly dominating them
+            std::vector<char> frontier(slots, 0);
+            for (const int member : tree.frontier(id(node)))
+                frontier[slot(member)] = 1;
+
+            for (std::size_t other = 0; other < slots; ++other) {
+                if (!reached[other])
+                    continue;
+
+                bool expected = false;
+                for (const int previous : edges.incoming[other]) {
+                    if (reached[slot(previous)] && dominators[slot(previous)].test(node))
+                        expected = true;
+                }
+                expected = expected && !(dominators[other].test(node) && other != node);
+                if ((frontier[other] != 0) != expected)
+                    check(false, what + ": frontier of " + std::to_string(id(node)) + " at " + std::to_string(id(other)));
+            }
+        }
+    }
+
+    double milliseconds(const auto& run) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main() {
+    for (unsigned seed = 1; seed <= 20; ++seed) {
+        const auto graph = random_graph(200, seed);
+        compare(graph.dominators(), edges_of(graph, true), compiler::ENTRY, "dominators, seed " + std::to_string(seed));
+        compare(graph.post_dominators(), edges_of(graph, false), compiler::EXIT, "post-dominators, seed " + std::to_string(seed));
+        if (compiler::tests::failures > 0)
+            return EXIT_FAILURE;
+    }
+
+    constexpr int blocks = 10000;
+    constexpr int runs = 10;
+    for (unsigned seed = 1; seed <= 3; ++seed) {
+        auto graph = random_graph(blocks, seed);
+        double dominators = 0;
+        double post_dominators = 0;
+        double frontier_size = 0;
+        int reachable = 0;
+        for (int run = 0; run < runs; ++run) {
+            graph.invalidate_analyses();
+            dominators += milliseconds([&] { (void) graph.dominators(); });
+            post_dominators += milliseconds([&] { (void) graph.post_dominators(); });
+        }
+
+        for (const auto& node : graph.nodes) {
+            if (graph.dominators().contains(node.id))
+                ++reachable;
+            frontier_size += static_cast<double>(graph.dominators().frontier(node.id).size());
+        }
+
+        std::println("{} blocks ({} reachable), seed {}: dominators {:.2f}ms, post-dominators {:.2f}ms, {:.2f} frontier entries per block", blocks,
+                     reachable, seed, dominators / runs, post_dominators / runs, frontier_size / static_cast<double>(reachable));
+    }
+
+    //the largest graph is still checked once, the naive sets are quadratic in size but fine at this scale
+    const auto graph = random_graph(blocks, 1);
+    compare(graph.dominators(), edges_of(graph, true), compiler::ENTRY, "dominators, 10k blocks");
+
+    return compiler::tests::failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
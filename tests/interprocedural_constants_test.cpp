@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "test_support.hpp"
+#include "optimizations/optimizer.hpp"
+
+//A function specialized on a constant argument and its general copy both call another function. Each copy is
+//optimized on its own, so the results of the optimized program have to match the unoptimized one
+
+namespace {
+    using namespace compiler;
+
+    //ev and od are recursive and too large to inline, so the calls to them stay in both copies of k
+    const std::string source = R"(
+int ev(int n) {
+    int a = 0;
+    int b = 1;
+    a = a + n * 0; b = b - a;
+    a = a + n * 1; b = b - a;
+    a = a + n * 2; b = b - a;
+    a = a + n * 3; b = b - a;
+    a = a + n * 4; b = b - a;
+    a = a + n * 5; b = b - a;
+    a = a + n * 6; b = b - a;
+    a = a + n * 7; b = b - a;
+    a = a + n * 8; b = b - a;
+    a = a + n * 9; b = b - a;
+    a = a + n * 10; b = b - a;
+    a = a + n * 11; b = b - a;
+    a = a + n * 12; b = b - a;
+    a = a + n * 13; b = b - a;
+    a = a + n * 14; b = b - a;
+    if (n <= 0) {
+        return 1;
+    }
+    return od(n - 1) + b;
+}
+
+int od(int n) {
+    int a = 0;
+    int b = 1;
+    a = a + n * 0; b = b - a;
+    a = a + n * 1; b = b - a;
+    a = a + n * 2; b = b - a;
+    a = a + n * 3; b = b - a;
+    a = a + n * 4; b = b - a;
+    a = a + n * 5; b = b - a;
+    a = a + n * 6; b = b - a;
+    a = a + n * 7; b = b - a;
+    a = a + n * 8; b = b - a;
+    a = a + n * 9; b = b - a;
+    a = a + n * 10; b = b - a;
+    a = a + n * 11; b = b - a;
+    a = a + n * 12; b = b - a;
+    a = a + n * 13; b = b - a;
+    a = a + n * 14; b = b - a;
+    if (n <= 0) {
+        return 0;
+    }
+    return ev(n - 1) + b;
+}
+
+int k(int m) {
+    int r = 0;
+    if (m) {
+        r = 100;
+    }
+    return r + ev(m);
+}
+
+int test(int a) {
+    return k(1) * 1000 + k(a / 100000000 + 3);
+}
+)";
+
+    //Runs the flattened, non-SSA IR of a function. Enough for programs without globals
+    class Interpreter {
+    public:
+        explicit Interpreter(const ir::ir_program& program)
+            : program(program) {}
+
+        int call(const std::string& name, const std::vector<int>& arguments) {
+            const auto function = std::ranges::find_if(program.functions, [&](const ir::ir_function& function) {
+                return program.symbols.name(function.name) == name;
+            });
+            if (function == program.functions.end())
+                throw std::runtime_error("Unknown function " + name);
+
+            return call(function->name, arguments);
+        }
+
+    private:
+        const ir::ir_program& program;
+        int steps = 0;
+
+        int call(const std::uint32_t name, const std::vector<int>& arguments) {
+            const auto function = std::ranges::find(program.functions, name, &ir::ir_function::name);
+            if (function == program.functions.end())
+                throw std::runtime_error("Unknown function");
+
+            std::vector<ir::ir_instruction> code;
+            std::unordered_map<std::uint32_t, std::size_t> labels;
+            for (const auto& node : function->graph.nodes) {
+                for (const auto& instruction : node.instructions) {
+                    if (instruction.opcode == ir::ir_opcode::Label)
+                        labels[instruction.label()] = code.size();
+                    code.push_back(instruction);
+                }
+            }
+
+            std::unordered_map<ir::ir_value, int> values;
+            for (std::size_t i = 0; i < function->parameters.size(); ++i)
+                values[function->parameters[i]] = arguments.at(i);
+
+            const auto value = [&values](const ir::ir_value& operand) {
+                return operand.is_constant() ? operand.get_constant() : values.at(operand);
+            };
+
+            for (std::size_t position = 0; position < code.size(); ++position) {
+                if (++steps > 10'000'000)
+                    throw std::runtime_error("Program does not terminate");
+
+                const auto& instruction = code[position];
+                switch (instruction.opcode) {
+                case ir::ir_opcode::Return:
+                    return value(instruction.source());
+                case ir::ir_opcode::Binary:
+                    values[instruction.result()] =
+                        ConstantFolding::evaluate_binary(instruction.op(), value(instruction.left()), value(instruction.right())).value();
+                    break;
+                case ir::ir_opcode::Unary:
+                    values[instruction.result()] = ConstantFolding::evaluate_unary(instruction.op(), value(instruction.left())).value();
+                    break;
+                case ir::ir_opcode::Copy:
+                    values[instruction.result()] = value(instruction.source());
+                    break;
+                case ir::ir_opcode::Jump:
+                    position = labels.at(instruction.label());
+                    break;
+                case ir::ir_opcode::JumpIfZero:
+                case ir::ir_opcode::JumpIfNotZero:
+                    if ((value(instruction.source()) == 0) == (instruction.opcode == ir::ir_opcode::JumpIfZero))
+                        position = labels.at(instruction.label());
+                    break;
+                case ir::ir_opcode::Call: {
+                    std::vector<int> call_arguments;
+                    for (const auto& argument : program.operands.arguments(instruction))
+                        call_arguments.push_back(value(argument));
+                    values[instruction.result()] = call(instruction.callee(), call_arguments);
+                    break;
+                }
+                case ir::ir_opcode::Label:
+                    break;
+                case ir::ir_opcode::Phi:
+                    throw std::runtime_error("Phi outside of SSA form");
+                }
+            }
+            throw std::runtime_error("Function ends without a return");
+        }
+    };
+}
+
+int main() {
+    using tests::check;
+
+    //k is called with 1 and with a value only known at run time, so it gets a clone for the constant
+    auto specialized = tests::generate(source);
+    const auto functions = specialized.functions.size();
+    PassManager pipeline;
+    pipeline.add(std::make_unique<InterproceduralConstants>());
+    pipeline.run(specialized);
+    check(specialized.functions.size() == functions + 1, "k is not specialized");
+
+    const auto original = tests::generate(source);
+    auto optimized = tests::generate(source);
+    Optimizer optimizer;
+    optimizer.optimize(optimized);
+
+    Interpreter before(original);
+    Interpreter after(optimized);
+    for (const int argument : {-300000000, -1, 0, 5, 100000000, 200000000}) {
+        const auto expected = before.call("test", {argument});
+        const auto actual = after.call("test", {argument});
+        check(expected == actual, "test(" + std::to_string(argument) + ") returns " + std::to_string(actual) + " instead of " + std::to_string(expected));
+    }
+
+    return tests::failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
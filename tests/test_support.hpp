@@ -0,0 +1,28 @@
+#pragma once
+#include <print>
+#include <string>
+#include "ir/ir_function.h"
+#include "ir/ir_generator.h"
+#include "lexer/lexer.h"
+#include "parser/parser.h"
+
+//Shared by the test and benchmark targets. They are plain executables registered with ctest, a failed check
+//prints where it failed and the target exits with a non zero status
+namespace compiler::tests {
+    inline int failures = 0;
+
+    inline void check(const bool condition, const std::string& what) {
+        if (condition)
+            return;
+
+        ++failures;
+        std::println(stderr, "FAILED: {}", what);
+    }
+
+    inline ir::ir_program generate(const std::string& source) {
+        lexer::lexer lexer;
+        parser::parser parser;
+        ir::ir_generator generator;
+        return generator.generate(parser.parse_ast(lexer.parse_tokens(source)));
+    }
+}